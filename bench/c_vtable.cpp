@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/c_vtable.h"
+
+// The virtual dispatch path from the README's COM example
+struct IRefCounted {
+    virtual unsigned long AddRef() = 0;
+    virtual unsigned long Release() = 0;
+
+protected:
+    ~IRefCounted() = default;
+};
+
+struct com_object : IRefCounted, ref_counted_shared_ptr::std::ref_counted_shared_ptr<com_object> {
+    unsigned long AddRef() override {
+        return static_cast<unsigned long>(incref());
+    }
+    unsigned long Release() override {
+        return static_cast<unsigned long>(decref());
+    }
+};
+
+REF_COUNTED_SHARED_PTR_DEFINE_C_VTABLE(object_vtable, com_object);
+
+// A hand written per-language trampoline, translating exceptions into status codes
+extern "C" {
+static int trampoline_retain(const void* p, long* new_count) {
+    try {
+        *new_count = static_cast<long>(static_cast<IRefCounted*>(static_cast<com_object*>(const_cast<void*>(p)))->AddRef());
+        return REF_COUNTED_SHARED_PTR_OK;
+    } catch (const std::bad_weak_ptr&) {
+        return REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR;
+    }
+}
+static int trampoline_release(const void* p, long* new_count) {
+    try {
+        *new_count = static_cast<long>(static_cast<IRefCounted*>(static_cast<com_object*>(const_cast<void*>(p)))->Release());
+        return REF_COUNTED_SHARED_PTR_OK;
+    } catch (const std::bad_weak_ptr&) {
+        return REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR;
+    }
+}
+
+long retain_release_loop(const ref_counted_shared_ptr_vtable* vtable, const void* object, long iterations);
+}
+
+static const ref_counted_shared_ptr_vtable trampoline_vtable = { &trampoline_retain, &trampoline_release, nullptr, nullptr };
+
+static long virtual_loop(IRefCounted* volatile* p, long iterations) {
+    long count = 0;
+    for (long i = 0; i < iterations; ++i) {
+        count = static_cast<long>((*p)->AddRef());
+        count = static_cast<long>((*p)->Release());
+    }
+    return count;
+}
+
+template<typename F>
+static void run(const char* name, long iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+    long count = f();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("%-24s %8.2f ns per retain/release pair (final count %ld)\n", name, ns / static_cast<double>(iterations), count);
+}
+
+int main() {
+    const long iterations = 20000000;
+    auto owner = std::make_shared<com_object>();
+    IRefCounted* volatile as_interface = owner.get();
+    const void* as_handle = static_cast<const com_object*>(owner.get());
+
+    run("virtual AddRef/Release", iterations, [&] { return virtual_loop(&as_interface, iterations); });
+    run("C trampoline table", iterations, [&] { return retain_release_loop(&trampoline_vtable, as_handle, iterations); });
+    run("generated C vtable", iterations, [&] { return retain_release_loop(&object_vtable, as_handle, iterations); });
+}
@@ -0,0 +1,12 @@
+#include "ref_counted_shared_ptr/c_abi.h"
+
+/* Compiled as C so that calls through the table cannot be inlined into the benchmark loop */
+long retain_release_loop(const ref_counted_shared_ptr_vtable* vtable, const void* object, long iterations) {
+    long count = 0;
+    long i;
+    for (i = 0; i < iterations; ++i) {
+        vtable->retain(object, &count);
+        vtable->release(object, &count);
+    }
+    return count;
+}
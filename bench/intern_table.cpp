@@ -0,0 +1,76 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/intern_table.h"
+
+// Compares intern_table hits, which look the key up under the shard's lock, with the same lookup and try_incref()
+// without any lock. The unlocked lookup is only safe here because the map never changes and the objects are kept
+// alive; it is the most a lock free read path could save.
+struct symbol : ref_counted_shared_ptr::std::ref_counted_shared_ptr<symbol> {
+    explicit symbol(const std::string& name) : name(name) {}
+
+    const std::string& key() const {
+        return name;
+    }
+
+    using ref_counted_shared_ptr::try_incref;
+    using ref_counted_shared_ptr::decref;
+
+private:
+    std::string name;
+};
+
+using table_type = ref_counted_shared_ptr::intern_table<std::string, symbol>;
+
+template<typename F>
+static void run(const char* name, int threads, long iterations, F f) {
+    std::atomic<bool> start(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t != threads; ++t) {
+        workers.emplace_back([&, t] {
+            while (!start.load()) std::this_thread::yield();
+            f(t, iterations);
+        });
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto& w : workers) w.join();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    std::printf("%-20s %2d threads %8.2f ns per hit\n", name, threads, ns / static_cast<double>(iterations * threads));
+}
+
+int main() {
+    const long iterations = 2000000;
+    const int key_count = 1024;
+
+    table_type table;
+    std::vector<std::string> keys;
+    std::vector<table_type::handle> kept;
+    std::unordered_map<std::string, symbol*> unlocked;
+    for (int i = 0; i != key_count; ++i) {
+        keys.push_back("symbol" + std::to_string(i));
+        kept.push_back(table.intern(keys.back()));
+        unlocked.emplace(keys.back(), kept.back().get());
+    }
+
+    unsigned hardware = std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= static_cast<int>(hardware ? hardware : 1); threads *= 2) {
+        run("intern (locked)", threads, iterations, [&](int t, long n) {
+            for (long i = 0; i != n; ++i) table.intern(keys[static_cast<std::size_t>(i * 7 + t) % key_count]);
+        });
+        run("unlocked lookup", threads, iterations, [&](int t, long n) {
+            for (long i = 0; i != n; ++i) {
+                symbol* p = unlocked.find(keys[static_cast<std::size_t>(i * 7 + t) % key_count])->second;
+                if (p->try_incref() != 0) p->decref();
+            }
+        });
+    }
+}
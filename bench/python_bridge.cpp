@@ -0,0 +1,93 @@
+#include "ref_counted_shared_ptr/python.h"
+
+#include <memory>
+#include <new>
+
+#include "ref_counted_shared_ptr/std.h"
+
+// Extension module for bench/python_bridge.py, comparing the cached wrapper of ref_counted_shared_ptr/python.h against
+// a pybind11 style holder: a new Python object owning a copy of the shared_ptr every time the object crosses into
+// Python.
+
+struct node : ref_counted_shared_ptr::std::ref_counted_shared_ptr<node>, ref_counted_shared_ptr::python_wrapper_cache {
+    long value = 42;
+};
+
+using node_type = ref_counted_shared_ptr::python_type<node>;
+
+struct holder_object {
+    PyObject_HEAD
+    std::shared_ptr<node> holder;
+};
+
+static PyTypeObject* holder_type = nullptr;
+static std::shared_ptr<node> shared_node;
+
+static void holder_dealloc(PyObject* self) {
+    PyTypeObject* type = Py_TYPE(self);
+    reinterpret_cast<holder_object*>(self)->holder.~shared_ptr();
+    PyObject_Free(self);
+    Py_DECREF(reinterpret_cast<PyObject*>(type));
+}
+
+static PyObject* get_cached(PyObject*, PyObject*) {
+    return node_type::wrap(shared_node.get());
+}
+
+static PyObject* get_holder(PyObject*, PyObject*) {
+    holder_object* result = PyObject_New(holder_object, holder_type);
+    if (!result) return nullptr;
+    new (&result->holder) std::shared_ptr<node>(shared_node);
+    return reinterpret_cast<PyObject*>(result);
+}
+
+static PyObject* read_cached(PyObject*, PyObject* object) {
+    node* p = node_type::get(object);
+    if (!p) return nullptr;
+    return PyLong_FromLong(p->value);
+}
+
+static PyObject* read_holder(PyObject*, PyObject* object) {
+    if (Py_TYPE(object) != holder_type) {
+        PyErr_SetString(PyExc_TypeError, "expected a holder");
+        return nullptr;
+    }
+    return PyLong_FromLong(reinterpret_cast<holder_object*>(object)->holder->value);
+}
+
+static PyObject* use_count(PyObject*, PyObject*) {
+    return PyLong_FromLong(shared_node.use_count());
+}
+
+static PyMethodDef module_methods[] = {
+    { "get_cached", &get_cached, METH_NOARGS, "The node's cached wrapper" },
+    { "get_holder", &get_holder, METH_NOARGS, "A new holder owning a shared_ptr to the node" },
+    { "read_cached", &read_cached, METH_O, "The node's value, from its cached wrapper" },
+    { "read_holder", &read_holder, METH_O, "The node's value, from a holder" },
+    { "use_count", &use_count, METH_NOARGS, "The node's reference count" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyModuleDef module_definition = {
+    PyModuleDef_HEAD_INIT, "ref_counted_shared_ptr_bench_python", nullptr, -1, module_methods, nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC PyInit_ref_counted_shared_ptr_bench_python() {
+    static PyType_Slot holder_slots[] = {
+        { Py_tp_dealloc, reinterpret_cast<void*>(&holder_dealloc) },
+        { 0, nullptr }
+    };
+    static PyType_Spec holder_spec = { "ref_counted_shared_ptr_bench_python.Holder", static_cast<int>(sizeof(holder_object)), 0, Py_TPFLAGS_DEFAULT, holder_slots };
+
+    PyObject* module = PyModule_Create(&module_definition);
+    if (!module) return nullptr;
+    PyTypeObject* cached_type = node_type::create("ref_counted_shared_ptr_bench_python.Node");
+    holder_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&holder_spec));
+    if (!cached_type || !holder_type || PyModule_AddObject(module, "Node", reinterpret_cast<PyObject*>(cached_type)) != 0) {
+        Py_XDECREF(reinterpret_cast<PyObject*>(cached_type));
+        Py_DECREF(module);
+        return nullptr;
+    }
+    shared_node = std::make_shared<node>();
+    return module;
+}
@@ -0,0 +1,31 @@
+"""Times crossing a C++ object into Python and back, with a cached wrapper (ref_counted_shared_ptr/python.h) and with a
+pybind11 style shared_ptr holder.
+
+Usage: python3 bench/python_bridge.py <directory containing the ref_counted_shared_ptr_bench_python module>
+"""
+
+import sys
+import timeit
+
+if len(sys.argv) > 1:
+    sys.path.insert(0, sys.argv[1])
+
+import ref_counted_shared_ptr_bench_python as bench
+
+ITERATIONS = 2000000
+
+
+def run(name, statement):
+    seconds = min(timeit.repeat(statement, number=ITERATIONS, repeat=5, globals=globals()))
+    print(f'{name:<32} {seconds / ITERATIONS * 1e9:8.2f} ns')
+
+
+# Python keeps a reference to the node, so the cached wrapper is reused
+kept = bench.get_cached()
+held = bench.get_holder()
+print(f'use_count with one wrapper and one holder alive: {bench.use_count()}')
+
+run('C++ -> Python, cached wrapper', 'bench.get_cached()')
+run('C++ -> Python, shared_ptr holder', 'bench.get_holder()')
+run('Python -> C++, cached wrapper', 'bench.read_cached(kept)')
+run('Python -> C++, shared_ptr holder', 'bench.read_holder(held)')
@@ -1,12 +1,15 @@
 #ifndef REF_COUNTED_SHARED_PTR_BOOST_H_
 #define REF_COUNTED_SHARED_PTR_BOOST_H_
 
+#include <atomic>
 #include <type_traits>
 
 #include <boost/smart_ptr.hpp>
 
 #include "ref_counted_shared_ptr/impl/boost.h"
 #include "ref_counted_shared_ptr/impl/common.h"
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/detail/external_ref_counted_shared_ptr.h"
 
 
 namespace ref_counted_shared_ptr {
@@ -22,6 +25,8 @@ private:
 
     using implementation = ::ref_counted_shared_ptr::detail::common_implementation<::ref_counted_shared_ptr::detail::boost::implementation_information>;
 
+    friend struct ::ref_counted_shared_ptr::detail::access;
+
 protected:
     constexpr typed_ref_counted_shared_ptr() noexcept = default;
     typed_ref_counted_shared_ptr(const typed_ref_counted_shared_ptr&) noexcept = default;
@@ -34,14 +39,58 @@ protected:
         return static_cast<void>(crtp_checks()), implementation::incref(*this);
     }
 
+    long incref(const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::incref(*this, tag);
+    }
+
+    long incref(long n) const {
+        return static_cast<void>(crtp_checks()), implementation::incref(*this, n);
+    }
+
+    long incref(long n, const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::incref(*this, n, tag);
+    }
+
+    long try_incref() const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::try_incref(*this);
+    }
+
     long decref() const {
         return static_cast<void>(crtp_checks()), implementation::decref(*this);
     }
 
+    long decref(const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::decref(*this, tag);
+    }
+
+    long decref(long n) const {
+        return static_cast<void>(crtp_checks()), implementation::decref(*this, n);
+    }
+
+    long decref(long n, const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::decref(*this, n, tag);
+    }
+
     long use_count() const noexcept {
         return static_cast<void>(crtp_checks()), implementation::use_count(*this);
     }
 
+    void prefetch_count() const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::prefetch_count(*this);
+    }
+
+    void make_immortal() const {
+        return static_cast<void>(crtp_checks()), implementation::make_immortal(*this);
+    }
+
+    bool is_immortal() const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::is_immortal(*this);
+    }
+
+    bool is_unique() const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::is_unique(*this);
+    }
+
 public:
     ::boost::weak_ptr<Self> weak_from_this() noexcept {
         return static_cast<void>(crtp_checks()), implementation::weak_from_this(*this);
@@ -57,6 +106,7 @@ struct enable_shared_from_void : ::ref_counted_shared_ptr::boost::typed_ref_coun
 }
 
 REF_COUNTED_SHARED_PTR_DEFINE_PRIVATE_ACCESSORS_BOOST(void);
+REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_BOOST(const void);
 
 namespace ref_counted_shared_ptr {
 namespace boost {
@@ -70,14 +120,56 @@ private:
     }
 
     using base = ::ref_counted_shared_ptr::boost::enable_shared_from_void;
+    using implementation = ::ref_counted_shared_ptr::detail::common_implementation<::ref_counted_shared_ptr::detail::boost::implementation_information>;
+
+    friend struct ::ref_counted_shared_ptr::detail::access;
 protected:
     using base::base;
     using base::operator=;
     ~ref_counted_shared_ptr() = default;
 
-    using base::incref;
-    using base::decref;
+    // Same as the base's, but traced as `Self` instead of `void`
+    long incref() const {
+        return static_cast<void>(crtp_checks()), implementation::template incref<Self>(*this);
+    }
+
+    long incref(const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::template incref<Self>(*this, tag);
+    }
+
+    long incref(long n) const {
+        return static_cast<void>(crtp_checks()), implementation::template incref<Self>(*this, n);
+    }
+
+    long incref(long n, const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::template incref<Self>(*this, n, tag);
+    }
+
+    long try_incref() const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::template try_incref<Self>(*this);
+    }
+
+    long decref() const {
+        return static_cast<void>(crtp_checks()), implementation::template decref<Self>(*this);
+    }
+
+    long decref(const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::template decref<Self>(*this, tag);
+    }
+
+    long decref(long n) const {
+        return static_cast<void>(crtp_checks()), implementation::template decref<Self>(*this, n);
+    }
+
+    long decref(long n, const ::std::nothrow_t& tag) const noexcept {
+        return static_cast<void>(crtp_checks()), implementation::template decref<Self>(*this, n, tag);
+    }
+
     using base::use_count;
+    using base::prefetch_count;
+    using base::make_immortal;
+    using base::is_immortal;
+    using base::is_unique;
 public:
     ::boost::shared_ptr<Self> shared_from_this() {
         return static_cast<void>(crtp_checks()), ::boost::static_pointer_cast<Self>(::boost::shared_ptr<void>(base::weak_from_this()));
@@ -96,6 +188,149 @@ public:
     }
 };
 
+}
+
+namespace detail {
+namespace boost {
+
+template<typename T>
+using is_external = ::std::is_base_of<::ref_counted_shared_ptr::detail::external_reference_count, typename ::std::remove_cv<T>::type>;
+
+template<typename T>
+void release_to_manual(T& object, ::boost::shared_ptr<T>& p, ::std::false_type) {
+    ::ref_counted_shared_ptr::detail::common_implementation<::ref_counted_shared_ptr::detail::boost::implementation_information>::template release_to_manual<typename ::std::remove_cv<T>::type>(object, p);
+}
+
+// The reference moves from the control block to the external count, which only modifies the control block if the
+// external count was 0
+template<typename T>
+void release_to_manual(T& object, ::boost::shared_ptr<T>& p, ::std::true_type) {
+    ::ref_counted_shared_ptr::detail::access::incref(object);
+    p.reset();
+}
+
+template<typename T>
+::boost::shared_ptr<T> adopt_manual(T* p, ::std::false_type) {
+    return ::ref_counted_shared_ptr::detail::common_implementation<::ref_counted_shared_ptr::detail::boost::implementation_information>::adopt_manual(*p, p);
+}
+
+template<typename T>
+::boost::shared_ptr<T> adopt_manual(T* p, ::std::true_type) {
+    ::boost::shared_ptr<T> result(p->shared_from_this(), p);
+    ::ref_counted_shared_ptr::detail::access::decref(*p);
+    return result;
+}
+
+}
+}
+
+namespace boost {
+
+// Gives the reference owned by `p` to the object it points to, as if by `p->incref(); p.reset();` but without modifying
+// the reference count (unless `p` was made with the aliasing constructor). Returns the object, which the caller
+// must later `decref()`. Throws bad_weak_ptr (leaving `p` unchanged) if the object has no control block.
+template<typename T>
+T* release_to_manual(::boost::shared_ptr<T>&& p) {
+    T* object = p.get();
+    if (object) ::ref_counted_shared_ptr::detail::boost::release_to_manual(*object, p, ::ref_counted_shared_ptr::detail::boost::is_external<T>());
+    return object;
+}
+
+// Returns a shared_ptr which takes over one reference from a previous `p->incref()`, as if by
+// `p->shared_from_this()` followed by `p->decref()`, without modifying the reference count (writing the shared_ptr
+// directly if REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_BOOST(T) has been used, otherwise with the aliasing
+// move constructor). Returns an empty shared_ptr if `p` is null.
+template<typename T>
+::boost::shared_ptr<T> adopt_manual(T* p) {
+    if (!p) return {};
+    return ::ref_counted_shared_ptr::detail::boost::adopt_manual(p, ::ref_counted_shared_ptr::detail::boost::is_external<T>());
+}
+
+// A ref_counted_shared_ptr<Self> whose objects are always immortal. incref() and decref() do nothing and return
+// immortal_use_count without looking at the control block, so objects do not need to be owned by a shared_ptr
+// (e.g., they can be statics) unless shared_from_this() or weak_from_this() is used.
+template<typename Self>
+struct immortal_ref_counted_shared_ptr : ::ref_counted_shared_ptr::boost::ref_counted_shared_ptr<Self> {
+private:
+    using base = ::ref_counted_shared_ptr::boost::ref_counted_shared_ptr<Self>;
+
+    friend struct ::ref_counted_shared_ptr::detail::access;
+protected:
+    using base::base;
+    using base::operator=;
+    ~immortal_ref_counted_shared_ptr() = default;
+
+    long incref() const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long incref(const ::std::nothrow_t&) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long incref(long) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long incref(long, const ::std::nothrow_t&) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long try_incref() const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long decref() const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long decref(const ::std::nothrow_t&) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long decref(long) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long decref(long, const ::std::nothrow_t&) const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    long use_count() const noexcept {
+        return ::ref_counted_shared_ptr::immortal_use_count;
+    }
+
+    void prefetch_count() const noexcept {}
+
+    void make_immortal() const noexcept {}
+
+    bool is_immortal() const noexcept {
+        return true;
+    }
+
+    bool is_unique() const noexcept {
+        return false;
+    }
+};
+
+// A ref_counted_shared_ptr<Self> with a second, external reference count for references taken by incref() (e.g. by
+// foreign callers), kept in the object on its own cache line. All of the external references together own one
+// reference in the control block, so only the external count going from 0 to 1 or from 1 to 0 modifies the control
+// block, and incref()/decref() do not contend with shared_ptr copies.
+// incref() returns the new external count. decref() returns the new external count, or when that reaches 0, the
+// number of references left in the control block (0 if *this was destroyed). use_count() counts both.
+template<typename Self>
+struct external_ref_counted_shared_ptr : ::ref_counted_shared_ptr::detail::external_ref_counted_shared_ptr_base<::ref_counted_shared_ptr::boost::ref_counted_shared_ptr<Self>, ::boost::bad_weak_ptr> {
+private:
+    using base = ::ref_counted_shared_ptr::detail::external_ref_counted_shared_ptr_base<::ref_counted_shared_ptr::boost::ref_counted_shared_ptr<Self>, ::boost::bad_weak_ptr>;
+
+    friend struct ::ref_counted_shared_ptr::detail::access;
+protected:
+    using base::base;
+    using base::operator=;
+    ~external_ref_counted_shared_ptr() = default;
+};
+
 }
 }
 
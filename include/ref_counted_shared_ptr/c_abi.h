@@ -0,0 +1,37 @@
+#ifndef REF_COUNTED_SHARED_PTR_C_ABI_H_
+#define REF_COUNTED_SHARED_PTR_C_ABI_H_
+
+/* C interface to a table of reference counting functions for a single type, defined in C++ with
+ * REF_COUNTED_SHARED_PTR_DEFINE_C_VTABLE (in "ref_counted_shared_ptr/c_vtable.h").
+ * None of the functions throw, instead returning one of the status codes below. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    REF_COUNTED_SHARED_PTR_OK = 0,
+    /* The object has never been owned by a shared_ptr (incref() would have thrown bad_weak_ptr) */
+    REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR = 1,
+    /* try_retain only: The reference count had already reached 0 (or the object was never owned by a shared_ptr) */
+    REF_COUNTED_SHARED_PTR_EXPIRED = 2
+};
+
+typedef struct ref_counted_shared_ptr_vtable {
+    /* incref(). If new_count is not NULL, the new reference count is stored there. */
+    int (*retain)(const void* object, long* new_count);
+    /* decref(). If 0 is stored in new_count, object has been destroyed. */
+    int (*release)(const void* object, long* new_count);
+    /* use_count(). Never fails. */
+    long (*use_count)(const void* object);
+    /* incref(), but only if the reference count has not already reached 0. */
+    int (*try_retain)(const void* object, long* new_count);
+} ref_counted_shared_ptr_vtable;
+
+#define REF_COUNTED_SHARED_PTR_DECLARE_C_VTABLE(name) extern const ref_counted_shared_ptr_vtable name
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* REF_COUNTED_SHARED_PTR_C_ABI_H_ */
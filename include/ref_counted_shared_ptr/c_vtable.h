@@ -0,0 +1,65 @@
+#ifndef REF_COUNTED_SHARED_PTR_C_VTABLE_H_
+#define REF_COUNTED_SHARED_PTR_C_VTABLE_H_
+
+#include <new>
+
+#include "ref_counted_shared_ptr/c_abi.h"
+#include "ref_counted_shared_ptr/detail/access.h"
+
+
+// REF_COUNTED_SHARED_PTR_DEFINE_C_VTABLE(name, T) defines `extern "C" const ref_counted_shared_ptr_vtable name` for objects
+// of type `T`. Must appear once at file scope in the global (`::`) namespace. The `const void*` arguments of the functions
+// in the table must have been converted from a `const T*`.
+#define REF_COUNTED_SHARED_PTR_DEFINE_C_VTABLE(name, ...)                                                                      \
+extern "C" {                                                                                                                   \
+static int name ## _retain_(const void* p, long* new_count) {                                                                  \
+    return ::ref_counted_shared_ptr::detail::c_vtable_functions< __VA_ARGS__ >::retain(p, new_count);                         \
+}                                                                                                                              \
+static int name ## _release_(const void* p, long* new_count) {                                                                 \
+    return ::ref_counted_shared_ptr::detail::c_vtable_functions< __VA_ARGS__ >::release(p, new_count);                        \
+}                                                                                                                              \
+static long name ## _use_count_(const void* p) {                                                                               \
+    return ::ref_counted_shared_ptr::detail::c_vtable_functions< __VA_ARGS__ >::use_count(p);                                 \
+}                                                                                                                              \
+static int name ## _try_retain_(const void* p, long* new_count) {                                                              \
+    return ::ref_counted_shared_ptr::detail::c_vtable_functions< __VA_ARGS__ >::try_retain(p, new_count);                     \
+}                                                                                                                              \
+}                                                                                                                              \
+extern "C" const ::ref_counted_shared_ptr_vtable name = { &name ## _retain_, &name ## _release_, &name ## _use_count_, &name ## _try_retain_ }
+
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+template<typename T>
+struct c_vtable_functions {
+    static int retain(const void* object, long* new_count) noexcept {
+        long count = ::ref_counted_shared_ptr::detail::access::incref(*static_cast<const T*>(object), ::std::nothrow);
+        if (count == 0) return REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR;
+        if (new_count) *new_count = count;
+        return REF_COUNTED_SHARED_PTR_OK;
+    }
+
+    static int release(const void* object, long* new_count) noexcept {
+        long count = ::ref_counted_shared_ptr::detail::access::decref(*static_cast<const T*>(object), ::std::nothrow);
+        if (count < 0) return REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR;
+        if (new_count) *new_count = count;
+        return REF_COUNTED_SHARED_PTR_OK;
+    }
+
+    static long use_count(const void* object) noexcept {
+        return ::ref_counted_shared_ptr::detail::access::use_count(*static_cast<const T*>(object));
+    }
+
+    static int try_retain(const void* object, long* new_count) noexcept {
+        long count = ::ref_counted_shared_ptr::detail::access::try_incref(*static_cast<const T*>(object));
+        if (count == 0) return REF_COUNTED_SHARED_PTR_EXPIRED;
+        if (new_count) *new_count = count;
+        return REF_COUNTED_SHARED_PTR_OK;
+    }
+};
+
+}
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_C_VTABLE_H_
@@ -0,0 +1,179 @@
+#ifndef REF_COUNTED_SHARED_PTR_COROUTINE_H_
+#define REF_COUNTED_SHARED_PTR_COROUTINE_H_
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define REF_COUNTED_SHARED_PTR_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef REF_COUNTED_SHARED_PTR_HAS_COROUTINES
+
+#include <coroutine>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+struct keep_alive_operations {
+    // Returns false if `p` could not be `incref()`ed
+    bool (*incref)(const void* p) noexcept;
+    void (*decref)(const void* p) noexcept;
+};
+
+template<typename T>
+bool keep_alive_incref(const void* p) noexcept {
+    return ::ref_counted_shared_ptr::detail::access::incref(*static_cast<const T*>(p), ::std::nothrow) != 0;
+}
+
+template<typename T>
+void keep_alive_decref(const void* p) noexcept {
+    ::ref_counted_shared_ptr::detail::access::decref(*static_cast<const T*>(p), ::std::nothrow);
+}
+
+// `p->get_executor().execute(f)` runs the decref, unless it throws, in which case it is done now
+template<typename T>
+void keep_alive_decref_on_executor(const void* p) noexcept {
+    const T* object = static_cast<const T*>(p);
+    try {
+        object->get_executor().execute([object]() noexcept {
+            ::ref_counted_shared_ptr::detail::access::decref(*object, ::std::nothrow);
+        });
+    } catch (...) {
+        ::ref_counted_shared_ptr::detail::access::decref(*object, ::std::nothrow);
+    }
+}
+
+template<typename T>
+struct keep_alive_table {
+    static constexpr keep_alive_operations inline_decref = { &keep_alive_incref<T>, &keep_alive_decref<T> };
+    static constexpr keep_alive_operations executor_decref = { &keep_alive_incref<T>, &keep_alive_decref_on_executor<T> };
+};
+
+// The awaiter an awaitable produces when `co_await`ed (its `operator co_await()`, or itself)
+template<typename Awaitable>
+auto get_awaiter(Awaitable&& awaitable, int) -> decltype(static_cast<Awaitable&&>(awaitable).operator co_await()) {
+    return static_cast<Awaitable&&>(awaitable).operator co_await();
+}
+
+template<typename Awaitable>
+auto get_awaiter(Awaitable&& awaitable, long) -> decltype(operator co_await(static_cast<Awaitable&&>(awaitable))) {
+    return operator co_await(static_cast<Awaitable&&>(awaitable));
+}
+
+template<typename Awaitable>
+Awaitable&& get_awaiter(Awaitable&& awaitable, ...) {
+    return static_cast<Awaitable&&>(awaitable);
+}
+
+}
+
+// Returned by `keep_alive` and `keep_alive_on_executor`, to be `co_await`ed in a coroutine whose promise type derives
+// from keep_alive_promise
+template<typename T>
+struct keep_alive_t {
+    const T* object;
+    const ::ref_counted_shared_ptr::detail::keep_alive_operations* operations;
+};
+
+namespace detail {
+
+template<typename T>
+struct is_keep_alive : ::std::false_type {};
+
+template<typename T>
+struct is_keep_alive<::ref_counted_shared_ptr::keep_alive_t<T>> : ::std::true_type {};
+
+}
+
+// `co_await keep_alive(*this)` keeps `*this` (deriving from ref_counted_shared_ptr) alive for the rest of the
+// coroutine, by calling `incref()` when the coroutine first suspends and `decref()` when its frame is destroyed.
+// Does not suspend.
+template<typename T>
+keep_alive_t<T> keep_alive(const T& object) noexcept {
+    return { &object, &::ref_counted_shared_ptr::detail::keep_alive_table<T>::inline_decref };
+}
+
+// Same as `keep_alive`, but the `decref()` is run by `object.get_executor().execute(f)`
+template<typename T>
+keep_alive_t<T> keep_alive_on_executor(const T& object) noexcept {
+    return { &object, &::ref_counted_shared_ptr::detail::keep_alive_table<T>::executor_decref };
+}
+
+// Mixin for coroutine promise types. After `co_await keep_alive(*this)`, every other `co_await` in the coroutine goes
+// through `await_transform`, which `incref()`s the object just before the coroutine suspends for the first time.
+// Coroutines that finish without suspending never modify the reference count.
+// Awaitables with an `await_suspend` that may return without suspending still count as a suspension.
+// `initial_suspend()` and `final_suspend()` are not transformed, so a coroutine that starts suspended must be kept
+// alive by its caller until it is resumed.
+class keep_alive_promise {
+public:
+    keep_alive_promise() noexcept = default;
+
+    keep_alive_promise(const keep_alive_promise&) = delete;
+    keep_alive_promise& operator=(const keep_alive_promise&) = delete;
+
+    ~keep_alive_promise() {
+        if (pinned) operations->decref(object);
+    }
+
+    template<typename T>
+    ::std::suspend_never await_transform(keep_alive_t<T> target) noexcept {
+        if (pinned) operations->decref(object);
+        object = target.object;
+        operations = target.operations;
+        pinned = false;
+        return {};
+    }
+
+    template<typename Awaitable>
+    class awaiter {
+    public:
+        using awaiter_type = decltype(::ref_counted_shared_ptr::detail::get_awaiter(::std::declval<Awaitable>(), 0));
+
+        awaiter(keep_alive_promise& promise, Awaitable&& awaitable) : promise(promise), inner(::ref_counted_shared_ptr::detail::get_awaiter(static_cast<Awaitable&&>(awaitable), 0)) {}
+
+        bool await_ready() {
+            return inner.await_ready();
+        }
+
+        template<typename Promise>
+        decltype(auto) await_suspend(::std::coroutine_handle<Promise> handle) {
+            promise.pin();
+            return inner.await_suspend(handle);
+        }
+
+        decltype(auto) await_resume() {
+            return inner.await_resume();
+        }
+
+    private:
+        keep_alive_promise& promise;
+        awaiter_type inner;
+    };
+
+    template<typename Awaitable, typename = typename ::std::enable_if<!::ref_counted_shared_ptr::detail::is_keep_alive<typename ::std::decay<Awaitable>::type>::value>::type>
+    awaiter<Awaitable> await_transform(Awaitable&& awaitable) {
+        return awaiter<Awaitable>(*this, static_cast<Awaitable&&>(awaitable));
+    }
+
+private:
+    const void* object = nullptr;
+    const ::ref_counted_shared_ptr::detail::keep_alive_operations* operations = nullptr;
+    bool pinned = false;
+
+    void pin() noexcept {
+        if (object && !pinned) pinned = operations->incref(object);
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_HAS_COROUTINES
+
+#endif  // REF_COUNTED_SHARED_PTR_COROUTINE_H_
@@ -0,0 +1,94 @@
+#ifndef REF_COUNTED_SHARED_PTR_COW_REF_H_
+#define REF_COUNTED_SHARED_PTR_COW_REF_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+#include "ref_counted_shared_ptr/std.h"
+
+
+namespace ref_counted_shared_ptr {
+
+// Copy on write handle to a copy constructible `T` deriving from std::ref_counted_shared_ptr<T>.
+// Copies of a cow_ref share the same object. `write()` gives mutable access, first replacing the object with a copy
+// (made with std::make_shared) if any other reference to it exists, including shared_ptrs.
+// Only supports std::shared_ptr, since the objects are made and adopted with std.h.
+template<typename T>
+class cow_ref {
+public:
+    using element_type = T;
+
+    constexpr cow_ref() noexcept = default;
+    constexpr cow_ref(::std::nullptr_t) noexcept {}
+
+    // Takes over the reference owned by `p`
+    explicit cow_ref(ref_counted_ptr<T> p) noexcept : ptr(::std::move(p)) {}
+
+    // Takes over the reference owned by `p` without modifying the reference count
+    explicit cow_ref(::std::shared_ptr<T>&& p) : ptr(::ref_counted_shared_ptr::std::release_to_manual(::std::move(p)), adopt_ref) {}
+
+    const T* get() const noexcept {
+        return ptr.get();
+    }
+
+    const T& operator*() const noexcept {
+        return *ptr;
+    }
+
+    const T* operator->() const noexcept {
+        return ptr.get();
+    }
+
+    explicit operator bool() const noexcept {
+        return static_cast<bool>(ptr);
+    }
+
+    // Whether this is the only reference to the object (so `write()` will not copy). Must not be null.
+    bool unique() const noexcept {
+        return ::ref_counted_shared_ptr::detail::access::is_unique(*ptr);
+    }
+
+    // Mutable access to the object, which is copied first unless `unique()`. Must not be null.
+    // If copying throws, *this is unchanged.
+    T& write() {
+        if (!unique()) {
+            ref_counted_ptr<T> copy(::ref_counted_shared_ptr::std::release_to_manual(::std::make_shared<T>(static_cast<const T&>(*ptr))), adopt_ref);
+            ptr.swap(copy);
+        }
+        return *ptr;
+    }
+
+    // A new reference to the shared object
+    ref_counted_ptr<const T> share() const noexcept {
+        return ref_counted_ptr<const T>(ptr);
+    }
+
+    void reset() noexcept {
+        ptr.reset();
+    }
+
+    void swap(cow_ref& other) noexcept {
+        ptr.swap(other.ptr);
+    }
+
+private:
+    ref_counted_ptr<T> ptr;
+};
+
+// Constructs a `T` with std::make_shared and returns the only reference to it
+template<typename T, typename... Args>
+cow_ref<T> make_cow(Args&&... args) {
+    return cow_ref<T>(::std::make_shared<T>(::std::forward<Args>(args)...));
+}
+
+template<typename T>
+void swap(cow_ref<T>& a, cow_ref<T>& b) noexcept {
+    a.swap(b);
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_COW_REF_H_
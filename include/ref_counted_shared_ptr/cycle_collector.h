@@ -0,0 +1,384 @@
+#ifndef REF_COUNTED_SHARED_PTR_CYCLE_COLLECTOR_H_
+#define REF_COUNTED_SHARED_PTR_CYCLE_COLLECTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+
+
+namespace ref_counted_shared_ptr {
+
+class cycle_visitor;
+
+namespace detail {
+
+class cycle_node;
+class cycle_collector;
+
+// Type erased operations on a cycle_collectable<Self, Base>. incref and decref are Base's, which never buffer roots.
+struct cycle_node_type {
+    void (*traverse)(cycle_node&, cycle_visitor&);
+    long (*incref)(const cycle_node&);
+    long (*decref)(const cycle_node&);
+    long (*use_count)(const cycle_node&);
+};
+
+// Bookkeeping for the cycle collector, as a base of every cycle_collectable<Self, Base>
+class cycle_node {
+protected:
+    explicit cycle_node(const cycle_node_type& type) noexcept
+        : cycle_type(&type), cycle_state(not_buffered), cycle_color(color::black), cycle_trial_count(0) {}
+    cycle_node(const cycle_node& other) noexcept : cycle_node(*other.cycle_type) {}
+    cycle_node& operator=(const cycle_node&) noexcept {
+        return *this;
+    }
+    ~cycle_node() = default;
+
+    // Hands the caller's reference to the collector as a candidate root instead of releasing it.
+    // Returns false if this is already buffered (or being collected), in which case the caller should release it.
+    bool buffer_root() const noexcept;
+
+private:
+    friend class ::ref_counted_shared_ptr::cycle_visitor;
+    friend class ::ref_counted_shared_ptr::detail::cycle_collector;
+
+    enum : unsigned char {
+        not_buffered,
+        // In the collector's root buffer, which owns one reference
+        buffered,
+        // Taken from the root buffer by the running collection, or about to be destroyed by it
+        collecting
+    };
+
+    enum class color : unsigned char {
+        // Not part of a collection in progress (or reachable from outside)
+        black,
+        // Visited by the trial deletion
+        gray,
+        // Possibly garbage
+        white,
+        // Garbage, being destroyed
+        garbage
+    };
+
+    const cycle_node_type* cycle_type;
+    mutable ::std::atomic<unsigned char> cycle_state;
+    // Only used while collecting, with the collector's lock held
+    color cycle_color;
+    long cycle_trial_count;
+};
+
+}
+
+// Passed to `traverse`, which must call `visit(edge)` once for every owning pointer (`ref_counted_ptr<U>`,
+// `shared_ptr<U>`, ...) to another cycle_collectable object that the object holds.
+class cycle_visitor {
+public:
+    template<typename Pointer>
+    void operator()(Pointer& edge) {
+        if (!edge) return;
+        const ::ref_counted_shared_ptr::detail::cycle_node& target = *edge.get();
+        ::ref_counted_shared_ptr::detail::cycle_node& node = const_cast<::ref_counted_shared_ptr::detail::cycle_node&>(target);
+        if (mode == mode_type::clear) {
+            if (node.cycle_color == ::ref_counted_shared_ptr::detail::cycle_node::color::garbage) edge.reset();
+        } else {
+            visit(node);
+        }
+    }
+
+private:
+    friend class ::ref_counted_shared_ptr::detail::cycle_collector;
+
+    enum class mode_type {
+        mark_gray,
+        scan,
+        scan_black,
+        collect_white,
+        clear
+    };
+
+    cycle_visitor(mode_type mode, ::std::vector<::ref_counted_shared_ptr::detail::cycle_node*>& stack, ::std::vector<::ref_counted_shared_ptr::detail::cycle_node*>& garbage) noexcept
+        : mode(mode), stack(&stack), garbage(&garbage) {}
+
+    mode_type mode;
+    ::std::vector<::ref_counted_shared_ptr::detail::cycle_node*>* stack;
+    ::std::vector<::ref_counted_shared_ptr::detail::cycle_node*>* garbage;
+
+    void visit(::ref_counted_shared_ptr::detail::cycle_node& node);
+};
+
+namespace detail {
+
+// Synchronous trial deletion (Bacon and Rajan, "Concurrent Cycle Collection in Reference Counted Systems", 2001),
+// using a scratch count per object instead of modifying the real reference counts.
+class cycle_collector {
+public:
+    // Never destroyed, so objects can still be released during static destruction
+    static cycle_collector& instance() {
+        static cycle_collector* collector = new cycle_collector;
+        return *collector;
+    }
+
+    bool push_root(cycle_node& node) noexcept {
+        ::std::lock_guard<::std::mutex> lock(roots_mutex);
+        try {
+            roots.push_back(&node);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    ::std::size_t pending() {
+        ::std::lock_guard<::std::mutex> lock(roots_mutex);
+        return roots.size();
+    }
+
+    ::std::size_t collect(::std::size_t max_roots) {
+        // Destructors of garbage may release more objects, but must not start another collection on this thread
+        static thread_local bool collecting = false;
+        if (collecting) return 0;
+        ::std::lock_guard<::std::mutex> lock(collect_mutex);
+        collecting = true;
+        struct reset_collecting {
+            ~reset_collecting() { collecting = false; }
+        } reset;
+
+        ::std::vector<cycle_node*> batch;
+        {
+            ::std::lock_guard<::std::mutex> roots_lock(roots_mutex);
+            ::std::size_t count = roots.size() < max_roots ? roots.size() : max_roots;
+            batch.assign(roots.begin(), roots.begin() + static_cast<::std::ptrdiff_t>(count));
+            roots.erase(roots.begin(), roots.begin() + static_cast<::std::ptrdiff_t>(count));
+        }
+        for (cycle_node* root : batch) root->cycle_state.store(cycle_node::collecting, ::std::memory_order_relaxed);
+
+        ::std::vector<cycle_node*> stack;
+        ::std::vector<cycle_node*> garbage;
+
+        // Subtract every reference from an object reachable from the roots, leaving the number of outside references
+        cycle_visitor mark_gray(cycle_visitor::mode_type::mark_gray, stack, garbage);
+        for (cycle_node* root : batch) {
+            if (root->cycle_color == cycle_node::color::gray) continue;
+            start_trial(*root);
+            stack.push_back(root);
+            drain(stack, mark_gray);
+        }
+
+        // Objects with outside references (and everything reachable from them) are live, the rest might be garbage
+        cycle_visitor scan(cycle_visitor::mode_type::scan, stack, garbage);
+        ::std::vector<cycle_node*> black_stack;
+        cycle_visitor scan_black(cycle_visitor::mode_type::scan_black, black_stack, garbage);
+        for (cycle_node* root : batch) {
+            stack.push_back(root);
+            while (!stack.empty()) {
+                cycle_node* node = stack.back();
+                stack.pop_back();
+                if (node->cycle_color != cycle_node::color::gray) continue;
+                if (node->cycle_trial_count > 0) {
+                    node->cycle_color = cycle_node::color::black;
+                    black_stack.push_back(node);
+                    drain(black_stack, scan_black);
+                } else {
+                    node->cycle_color = cycle_node::color::white;
+                    node->cycle_type->traverse(*node, scan);
+                }
+            }
+        }
+
+        cycle_visitor collect_white(cycle_visitor::mode_type::collect_white, stack, garbage);
+        for (cycle_node* root : batch) {
+            if (root->cycle_color != cycle_node::color::white) continue;
+            root->cycle_color = cycle_node::color::garbage;
+            garbage.push_back(root);
+            stack.push_back(root);
+            drain(stack, collect_white);
+        }
+
+        // Keep the garbage alive while breaking the cycles, so that every object is destroyed by its own last decref
+        for (cycle_node* node : garbage) node->cycle_type->incref(*node);
+        for (cycle_node* root : batch) {
+            if (root->cycle_color != cycle_node::color::garbage) {
+                root->cycle_color = cycle_node::color::black;
+                root->cycle_state.store(cycle_node::not_buffered, ::std::memory_order_release);
+            }
+            root->cycle_type->decref(*root);
+        }
+        cycle_visitor clear(cycle_visitor::mode_type::clear, stack, garbage);
+        for (cycle_node* node : garbage) node->cycle_type->traverse(*node, clear);
+        for (cycle_node* node : garbage) node->cycle_type->decref(*node);
+        return garbage.size();
+    }
+
+private:
+    ::std::mutex roots_mutex;
+    ::std::deque<cycle_node*> roots;
+    ::std::mutex collect_mutex;
+
+    cycle_collector() = default;
+
+    static void start_trial(cycle_node& node) noexcept {
+        node.cycle_color = cycle_node::color::gray;
+        // The root buffer's reference is not an outside reference for roots in this batch
+        long count = node.cycle_type->use_count(node);
+        if (node.cycle_state.load(::std::memory_order_relaxed) == cycle_node::collecting) --count;
+        node.cycle_trial_count = count;
+    }
+
+    static void drain(::std::vector<cycle_node*>& stack, cycle_visitor& visitor) {
+        while (!stack.empty()) {
+            cycle_node* node = stack.back();
+            stack.pop_back();
+            node->cycle_type->traverse(*node, visitor);
+        }
+    }
+
+    friend class ::ref_counted_shared_ptr::cycle_visitor;
+};
+
+inline bool cycle_node::buffer_root() const noexcept {
+    if (cycle_state.load(::std::memory_order_relaxed) != not_buffered) return false;
+    unsigned char expected = not_buffered;
+    if (!cycle_state.compare_exchange_strong(expected, buffered, ::std::memory_order_acq_rel, ::std::memory_order_relaxed)) return false;
+    if (::ref_counted_shared_ptr::detail::cycle_collector::instance().push_root(const_cast<cycle_node&>(*this))) return true;
+    cycle_state.store(not_buffered, ::std::memory_order_relaxed);
+    return false;
+}
+
+}
+
+inline void cycle_visitor::visit(::ref_counted_shared_ptr::detail::cycle_node& node) {
+    using color = ::ref_counted_shared_ptr::detail::cycle_node::color;
+    switch (mode) {
+        case mode_type::mark_gray:
+            if (node.cycle_color != color::gray) {
+                ::ref_counted_shared_ptr::detail::cycle_collector::start_trial(node);
+                stack->push_back(&node);
+            }
+            --node.cycle_trial_count;
+            break;
+        case mode_type::scan:
+            if (node.cycle_color == color::gray) stack->push_back(&node);
+            break;
+        case mode_type::scan_black:
+            ++node.cycle_trial_count;
+            if (node.cycle_color != color::black) {
+                node.cycle_color = color::black;
+                stack->push_back(&node);
+            }
+            break;
+        case mode_type::collect_white:
+            if (node.cycle_color == color::white) {
+                node.cycle_color = color::garbage;
+                node.cycle_state.store(::ref_counted_shared_ptr::detail::cycle_node::collecting, ::std::memory_order_relaxed);
+                garbage->push_back(&node);
+                stack->push_back(&node);
+            }
+            break;
+        case mode_type::clear:
+            break;
+    }
+}
+
+// Base for objects that can be part of reference cycles, where `Base` is `ref_counted_shared_ptr<Self>` (std or boost)
+// or `typed_ref_counted_shared_ptr<Self>`. `Self` must have a member function `void traverse(cycle_visitor& visit)`
+// (public, or accessible to ::ref_counted_shared_ptr::detail::access).
+//
+// When `decref()` leaves other references, the caller's reference is given to the cycle collector instead (without
+// modifying the reference count), and the object becomes a candidate root of a cycle. `collect_cycles()` releases the
+// candidate roots and destroys any garbage cycles reachable from them.
+template<typename Self, typename Base>
+struct cycle_collectable : Base, ::ref_counted_shared_ptr::detail::cycle_node {
+private:
+    friend struct ::ref_counted_shared_ptr::detail::access;
+
+    static const ::ref_counted_shared_ptr::detail::cycle_node_type node_type;
+
+    static const cycle_collectable& from_node(const ::ref_counted_shared_ptr::detail::cycle_node& node) noexcept {
+        return static_cast<const cycle_collectable&>(node);
+    }
+
+    static void traverse_node(::ref_counted_shared_ptr::detail::cycle_node& node, cycle_visitor& visitor) {
+        ::ref_counted_shared_ptr::detail::access::traverse(static_cast<Self&>(static_cast<cycle_collectable&>(node)), visitor);
+    }
+
+    static long incref_node(const ::ref_counted_shared_ptr::detail::cycle_node& node) {
+        return from_node(node).Base::incref(::std::nothrow);
+    }
+
+    static long decref_node(const ::ref_counted_shared_ptr::detail::cycle_node& node) {
+        return from_node(node).Base::decref(::std::nothrow);
+    }
+
+    static long use_count_node(const ::ref_counted_shared_ptr::detail::cycle_node& node) {
+        return from_node(node).Base::use_count();
+    }
+
+protected:
+    cycle_collectable() noexcept : ::ref_counted_shared_ptr::detail::cycle_node(node_type) {}
+    cycle_collectable(const cycle_collectable& other) noexcept : Base(other), ::ref_counted_shared_ptr::detail::cycle_node(other) {}
+
+    cycle_collectable& operator=(const cycle_collectable& other) noexcept {
+        Base::operator=(other);
+        return *this;
+    }
+
+    ~cycle_collectable() = default;
+
+    // If the reference is given to the cycle collector, the returned count does not include it
+    long decref() const {
+        if (Base::use_count() > 1 && buffer_root()) return Base::use_count() - 1;
+        return Base::decref();
+    }
+
+    long decref(const ::std::nothrow_t& tag) const noexcept {
+        if (Base::use_count() > 1 && buffer_root()) return Base::use_count() - 1;
+        return Base::decref(tag);
+    }
+
+    long decref(long n) const {
+        if (Base::use_count() > n && buffer_root()) return (n == 1 ? Base::use_count() : Base::decref(n - 1)) - 1;
+        return Base::decref(n);
+    }
+
+    long decref(long n, const ::std::nothrow_t& tag) const noexcept {
+        if (Base::use_count() > n && buffer_root()) return (n == 1 ? Base::use_count() : Base::decref(n - 1, tag)) - 1;
+        return Base::decref(n, tag);
+    }
+};
+
+template<typename Self, typename Base>
+const ::ref_counted_shared_ptr::detail::cycle_node_type cycle_collectable<Self, Base>::node_type = {
+    &cycle_collectable<Self, Base>::traverse_node,
+    &cycle_collectable<Self, Base>::incref_node,
+    &cycle_collectable<Self, Base>::decref_node,
+    &cycle_collectable<Self, Base>::use_count_node
+};
+
+// Looks for garbage cycles reachable from up to `max_roots` of the oldest candidate roots, releasing the collector's
+// references to them. Returns the number of objects destroyed because they were part of (or only reachable from)
+// garbage cycles. Destroying those objects may buffer more candidate roots, which are left for the next call.
+//
+// Collection is synchronous, and no mutator may run concurrently on the objects reachable from the roots: their
+// references to each other must not change, and they must not be incref'd or decref'd, until this returns. Other
+// objects can be used on other threads as usual. The pause grows with the number of objects reachable from the roots,
+// which `max_roots` does not bound: a single root can reach the whole graph. Returns 0 if called by a destructor of
+// garbage.
+inline ::std::size_t collect_cycles(::std::size_t max_roots = (::std::numeric_limits<::std::size_t>::max)()) {
+    return ::ref_counted_shared_ptr::detail::cycle_collector::instance().collect(max_roots);
+}
+
+// Number of candidate roots waiting for collect_cycles()
+inline ::std::size_t pending_cycle_roots() {
+    return ::ref_counted_shared_ptr::detail::cycle_collector::instance().pending();
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_CYCLE_COLLECTOR_H_
@@ -0,0 +1,136 @@
+#ifndef REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_H_
+#define REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+
+
+// Maximum number of distinct objects with deferred decrefs per thread before they are flushed automatically.
+// Must be a power of 2.
+#ifndef REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY
+#define REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY 256
+#endif
+
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+static_assert((REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY & (REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY - 1)) == 0, "REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY must be a power of 2");
+
+template<typename T>
+long deferred_release(const void* p, long n) noexcept {
+    return ::ref_counted_shared_ptr::detail::access::decref(*static_cast<const T*>(p), n, ::std::nothrow);
+}
+
+// Open addressing hash table from object address to the number of decrefs owed to it
+class deferred_decref_buffer {
+public:
+    static constexpr ::std::size_t capacity = REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY;
+    // Flush when the table is 3/4 full so probe sequences stay short
+    static constexpr ::std::size_t max_size = capacity - capacity / 4;
+    // Number of entries released at a time by flush()
+    static constexpr ::std::size_t flush_batch_size = 16;
+
+    deferred_decref_buffer() noexcept : entries(), used(0) {}
+
+    deferred_decref_buffer(const deferred_decref_buffer&) = delete;
+    deferred_decref_buffer& operator=(const deferred_decref_buffer&) = delete;
+
+    ~deferred_decref_buffer() {
+        flush();
+    }
+
+    template<typename T>
+    void push(const T& p) noexcept {
+        const void* object = static_cast<const void*>(&p);
+        ::std::size_t i = slot_for(object);
+        for (;; i = (i + 1) & (capacity - 1)) {
+            entry& e = entries[i];
+            if (e.object == object) {
+                ++e.count;
+                return;
+            }
+            if (!e.object) {
+                e.object = object;
+                e.count = 1;
+                e.release = &::ref_counted_shared_ptr::detail::deferred_release<T>;
+                if (++used == max_size) flush();
+                return;
+            }
+        }
+    }
+
+    // decrefs can destroy objects whose destructors defer (and flush) more decrefs, so keep going until the buffer stays
+    // empty. Entries are taken out a small batch at a time, so that every nested flush only needs a little stack.
+    // Emptying slots can break the probe sequence of other entries, so an object pushed again during the flush may get
+    // a second entry, which is still released correctly.
+    void flush() noexcept {
+        ::std::size_t next_slot = 0;
+        while (used != 0) {
+            entry batch[flush_batch_size];
+            ::std::size_t batch_count = 0;
+            for (::std::size_t scanned = 0; scanned != capacity && batch_count != flush_batch_size; ++scanned) {
+                entry& e = entries[next_slot];
+                next_slot = (next_slot + 1) & (capacity - 1);
+                if (e.object) {
+                    batch[batch_count++] = e;
+                    e = entry();
+                }
+            }
+            used -= batch_count;
+            for (::std::size_t i = 0; i != batch_count; ++i) batch[i].release(batch[i].object, batch[i].count);
+        }
+    }
+
+    ::std::size_t size() const noexcept {
+        return used;
+    }
+
+private:
+    struct entry {
+        const void* object;
+        long count;
+        long (*release)(const void*, long);
+    };
+
+    entry entries[capacity];
+    ::std::size_t used;
+
+    static ::std::size_t slot_for(const void* object) noexcept {
+        ::std::uint64_t mixed = static_cast<::std::uint64_t>(reinterpret_cast<::std::uintptr_t>(object)) * UINT64_C(0x9E3779B97F4A7C15);
+        return static_cast<::std::size_t>(mixed >> 32) & (capacity - 1);
+    }
+};
+
+inline deferred_decref_buffer& current_deferred_decref_buffer() noexcept {
+    static thread_local deferred_decref_buffer buffer;
+    return buffer;
+}
+
+}
+
+// Records a `p.decref()` to be done later by this thread, keeping `p` alive until then.
+// Repeated deferred decrefs of the same object are combined into one `decref(n)` when flushed.
+// The buffer is flushed by `flush_deferred_decrefs()`, when it has REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY * 3 / 4
+// distinct objects, and when the thread exits.
+template<typename T>
+void decref_deferred(const T& p) noexcept {
+    ::ref_counted_shared_ptr::detail::current_deferred_decref_buffer().push(p);
+}
+
+// Does all of this thread's deferred decrefs. Objects whose reference count reaches 0 are destroyed before this returns.
+inline void flush_deferred_decrefs() noexcept {
+    ::ref_counted_shared_ptr::detail::current_deferred_decref_buffer().flush();
+}
+
+// Number of distinct objects with deferred decrefs on this thread
+inline ::std::size_t pending_deferred_decrefs() noexcept {
+    return ::ref_counted_shared_ptr::detail::current_deferred_decref_buffer().size();
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_H_
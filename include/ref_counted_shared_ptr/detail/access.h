@@ -0,0 +1,97 @@
+#ifndef REF_COUNTED_SHARED_PTR_ACCESS_H_
+#define REF_COUNTED_SHARED_PTR_ACCESS_H_
+
+#include <new>
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+// Befriended by ref_counted_shared_ptr<Self> and typed_ref_counted_shared_ptr<Self> so that the
+// rest of the library can use their protected member functions on any `Self`, even if `Self` does
+// not make them public.
+struct access {
+    template<typename T>
+    static long incref(const T& p) {
+        return p.incref();
+    }
+
+    template<typename T>
+    static long incref(const T& p, const ::std::nothrow_t& tag) noexcept {
+        return p.incref(tag);
+    }
+
+    template<typename T>
+    static long incref(const T& p, long n) {
+        return p.incref(n);
+    }
+
+    template<typename T>
+    static long incref(const T& p, long n, const ::std::nothrow_t& tag) noexcept {
+        return p.incref(n, tag);
+    }
+
+    template<typename T>
+    static long try_incref(const T& p) noexcept {
+        return p.try_incref();
+    }
+
+    template<typename T>
+    static long decref(const T& p) {
+        return p.decref();
+    }
+
+    template<typename T>
+    static long decref(const T& p, const ::std::nothrow_t& tag) noexcept {
+        return p.decref(tag);
+    }
+
+    template<typename T>
+    static long decref(const T& p, long n) {
+        return p.decref(n);
+    }
+
+    template<typename T>
+    static long decref(const T& p, long n, const ::std::nothrow_t& tag) noexcept {
+        return p.decref(n, tag);
+    }
+
+    template<typename T>
+    static long use_count(const T& p) noexcept {
+        return p.use_count();
+    }
+
+    template<typename T>
+    static void prefetch_count(const T& p) noexcept {
+        p.prefetch_count();
+    }
+
+    template<typename T>
+    static void make_immortal(const T& p) {
+        p.make_immortal();
+    }
+
+    template<typename T>
+    static bool is_immortal(const T& p) noexcept {
+        return p.is_immortal();
+    }
+
+    template<typename T>
+    static bool is_unique(const T& p) noexcept {
+        return p.is_unique();
+    }
+
+    template<typename T>
+    static void recycle(T& p) noexcept {
+        p.recycle();
+    }
+
+    template<typename T, typename Visitor>
+    static void traverse(T& p, Visitor& visitor) {
+        p.traverse(visitor);
+    }
+};
+
+}
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_ACCESS_H_
@@ -0,0 +1,136 @@
+#ifndef REF_COUNTED_SHARED_PTR_EXTERNAL_REF_COUNTED_SHARED_PTR_H_
+#define REF_COUNTED_SHARED_PTR_EXTERNAL_REF_COUNTED_SHARED_PTR_H_
+
+#include <atomic>
+#include <cassert>
+#include <new>
+
+#include "ref_counted_shared_ptr/impl/common.h"
+#include "ref_counted_shared_ptr/detail/access.h"
+
+// Alignment of the external count of external_ref_counted_shared_ptr, which should be the size of a cache line.
+// make_shared only aligns objects to more than alignof(std::max_align_t) with C++17's aligned new.
+#ifndef REF_COUNTED_SHARED_PTR_CACHE_LINE_SIZE
+#define REF_COUNTED_SHARED_PTR_CACHE_LINE_SIZE 64
+#endif
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+// The implementation of std::external_ref_counted_shared_ptr<Self> and boost::external_ref_counted_shared_ptr<Self>,
+// where `Base` is the ref_counted_shared_ptr<Self> of the same library and `BadWeakPtr` it's bad_weak_ptr
+template<typename Base, typename BadWeakPtr>
+struct external_ref_counted_shared_ptr_base : Base, ::ref_counted_shared_ptr::detail::external_reference_count {
+private:
+    using base = Base;
+
+    friend struct ::ref_counted_shared_ptr::detail::access;
+protected:
+    external_ref_counted_shared_ptr_base() noexcept : external_count(0) {}
+    // A copy has no external references
+    external_ref_counted_shared_ptr_base(const external_ref_counted_shared_ptr_base& other) noexcept : base(other), ::ref_counted_shared_ptr::detail::external_reference_count(), external_count(0) {}
+
+    external_ref_counted_shared_ptr_base& operator=(const external_ref_counted_shared_ptr_base& other) noexcept {
+        base::operator=(other);
+        return *this;
+    }
+
+    ~external_ref_counted_shared_ptr_base() = default;
+
+    long incref() const {
+        return incref(1);
+    }
+
+    long incref(const ::std::nothrow_t& tag) const noexcept {
+        return incref(1, tag);
+    }
+
+    long incref(long n) const {
+        assert(n > 0);
+        long old_count = external_count.fetch_add(n, ::std::memory_order_relaxed);
+        if (old_count == 0) {
+            try {
+                base::incref();
+            } catch (...) {
+                external_count.fetch_sub(n, ::std::memory_order_relaxed);
+                throw;
+            }
+        }
+        return old_count + n;
+    }
+
+    long incref(long n, const ::std::nothrow_t& tag) const noexcept {
+        assert(n > 0);
+        long old_count = external_count.fetch_add(n, ::std::memory_order_relaxed);
+        if (old_count == 0 && base::incref(tag) == 0) {
+            external_count.fetch_sub(n, ::std::memory_order_relaxed);
+            return 0;
+        }
+        return old_count + n;
+    }
+
+    long try_incref() const noexcept {
+        long count = external_count.load(::std::memory_order_relaxed);
+        while (count != 0) {
+            if (external_count.compare_exchange_weak(count, count + 1, ::std::memory_order_relaxed)) return count + 1;
+        }
+        if (base::try_incref() == 0) return 0;
+        long old_count = external_count.fetch_add(1, ::std::memory_order_relaxed);
+        // Another thread took the control block reference for the external count first
+        if (old_count != 0) base::decref(::std::nothrow);
+        return old_count + 1;
+    }
+
+    long decref() const {
+        return decref(1);
+    }
+
+    long decref(const ::std::nothrow_t& tag) const noexcept {
+        return decref(1, tag);
+    }
+
+    long decref(long n) const {
+        long new_count = decref(n, ::std::nothrow);
+        if (new_count >= 0) return new_count;
+        throw BadWeakPtr();
+    }
+
+    // Returns -1 (leaving the external count unchanged) if there are fewer than `n` external references
+    long decref(long n, const ::std::nothrow_t& tag) const noexcept {
+        assert(n > 0);
+        long old_count = external_count.load(::std::memory_order_relaxed);
+        do {
+            if (old_count < n) return -1;
+        } while (!external_count.compare_exchange_weak(old_count, old_count - n, ::std::memory_order_acq_rel, ::std::memory_order_relaxed));
+        if (old_count != n) return old_count - n;
+        return base::decref(tag);
+    }
+
+    long use_count() const noexcept {
+        long external = external_count.load(::std::memory_order_relaxed);
+        long internal = base::use_count();
+        if (internal == 0 || internal == ::ref_counted_shared_ptr::immortal_use_count) return internal;
+        return internal - (external != 0 ? 1 : 0) + external;
+    }
+
+    long external_use_count() const noexcept {
+        return external_count.load(::std::memory_order_relaxed);
+    }
+
+    bool is_unique() const noexcept {
+        return external_count.load(::std::memory_order_acquire) <= 1 && base::is_unique();
+    }
+
+    // An immortal control block would still leave the external count to be modified
+    void make_immortal() const = delete;
+
+private:
+    // On a cache line of its own, away from the control block (which make_shared puts just before the object) and
+    // from Self's members, which follow this base
+    alignas(REF_COUNTED_SHARED_PTR_CACHE_LINE_SIZE) mutable ::std::atomic<long> external_count;
+};
+
+}
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_EXTERNAL_REF_COUNTED_SHARED_PTR_H_
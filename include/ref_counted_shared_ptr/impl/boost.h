@@ -1,9 +1,11 @@
 #ifndef REF_COUNTED_SHARED_PTR_IMPL_BOOST_H_
 #define REF_COUNTED_SHARED_PTR_IMPL_BOOST_H_
 
+#include <atomic>
 #include <type_traits>
 
 #include <boost/smart_ptr/enable_shared_from.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/smart_ptr/weak_ptr.hpp>
 #include <boost/smart_ptr/detail/sp_counted_base.hpp>
 
@@ -23,6 +25,19 @@ template struct ref_counted_shared_ptr::detail::make_private_member<         \
                                                                              \
 template<>                                                                   \
 struct ref_counted_shared_ptr::detail::boost::defined_private_accessors< __VA_ARGS__ > : ::std::true_type {}
+#define REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_BOOST(...)        \
+template struct ref_counted_shared_ptr::detail::make_private_member<         \
+    ::ref_counted_shared_ptr::detail::boost::px< __VA_ARGS__ >,              \
+    &::boost::shared_ptr< __VA_ARGS__ >::px                                  \
+>;                                                                           \
+                                                                             \
+template struct ref_counted_shared_ptr::detail::make_private_member<         \
+    ::ref_counted_shared_ptr::detail::boost::shared_pn< __VA_ARGS__ >,       \
+    &::boost::shared_ptr< __VA_ARGS__ >::pn                                  \
+>;                                                                           \
+                                                                             \
+template<>                                                                   \
+struct ref_counted_shared_ptr::detail::boost::defined_shared_ptr_accessors< __VA_ARGS__ > : ::std::true_type {}
 
 #include "ref_counted_shared_ptr/impl/redefine_macro.h"
 
@@ -46,6 +61,10 @@ template<typename T>
 struct weak_this_ : private_member<weak_this_<T>, ::boost::enable_shared_from_this<T>, ::boost::weak_ptr<T>> {};
 template<typename T>
 struct pn : private_member<pn<T>, ::boost::weak_ptr<T>, ::boost::detail::weak_count> {};
+template<typename T>
+struct px : private_member<px<T>, ::boost::shared_ptr<T>, typename ::boost::shared_ptr<T>::element_type*> {};
+template<typename T>
+struct shared_pn : private_member<shared_pn<T>, ::boost::shared_ptr<T>, ::boost::detail::shared_count> {};
 
 // Most implementations of the control block use "::boost::detail::atomic_decrement"
 // and "::boost::detail::atomic_conditional_increment" to manipulate a member "use_count_".
@@ -63,6 +82,15 @@ inline non_atomic_use_count_type atomic_conditional_increment(use_count_type& pw
     if (r != 0) ++pw;
     return r;
 }
+
+inline non_atomic_use_count_type atomic_add(use_count_type& pw, non_atomic_use_count_type n, ::boost::detail::sp_counted_base&) noexcept {
+    return pw += n;
+}
+
+inline non_atomic_use_count_type atomic_add_below(use_count_type& pw, non_atomic_use_count_type n, long limit, ::boost::detail::sp_counted_base&) noexcept {
+    if (pw < limit) pw += n;
+    return pw;
+}
 #elif defined(BOOST_SMART_PTR_DETAIL_SP_COUNTED_BASE_PT_HPP_INCLUDED)
 using use_count_type = ::boost::int_least32_t;
 using non_atomic_use_count_type = use_count_type;
@@ -81,6 +109,21 @@ inline non_atomic_use_count_type atomic_conditional_increment(use_count_type& pw
     BOOST_VERIFY( pthread_mutex_unlock(&ref_counter.*m_::get_value()) == 0 );
     return r;
 }
+
+inline non_atomic_use_count_type atomic_add(use_count_type& pw, non_atomic_use_count_type n, ::boost::detail::sp_counted_base& ref_counter) noexcept {
+    BOOST_VERIFY( pthread_mutex_lock(&ref_counter.*m_::get_value()) == 0 );
+    use_count_type result = pw += n;
+    BOOST_VERIFY( pthread_mutex_unlock(&ref_counter.*m_::get_value()) == 0 );
+    return result;
+}
+
+inline non_atomic_use_count_type atomic_add_below(use_count_type& pw, non_atomic_use_count_type n, long limit, ::boost::detail::sp_counted_base& ref_counter) noexcept {
+    BOOST_VERIFY( pthread_mutex_lock(&ref_counter.*m_::get_value()) == 0 );
+    if (pw < limit) pw += n;
+    use_count_type result = pw;
+    BOOST_VERIFY( pthread_mutex_unlock(&ref_counter.*m_::get_value()) == 0 );
+    return result;
+}
 #elif defined(BOOST_SMART_PTR_DETAIL_SP_COUNTED_BASE_W32_HPP_INCLUDED)
 using use_count_type = long;
 using non_atomic_use_count_type = use_count_type;
@@ -103,6 +146,18 @@ inline non_atomic_use_count_type atomic_conditional_increment(use_count_type& pw
 #endif
     }
 }
+
+inline non_atomic_use_count_type atomic_add(use_count_type& pw, non_atomic_use_count_type n, ::boost::detail::sp_counted_base&) noexcept {
+    return BOOST_SP_INTERLOCKED_EXCHANGE_ADD(&pw, n) + n;
+}
+
+inline non_atomic_use_count_type atomic_add_below(use_count_type& pw, non_atomic_use_count_type n, long limit, ::boost::detail::sp_counted_base&) noexcept {
+    for (;;) {
+        long tmp = static_cast<long const volatile&>(pw);
+        if (tmp >= limit) return tmp;
+        if( BOOST_SP_INTERLOCKED_COMPARE_EXCHANGE( &pw, tmp + n, tmp ) == tmp ) return tmp + n;
+    }
+}
 #else
 template<typename T1, typename T2>
 struct type_pair {
@@ -123,13 +178,53 @@ inline non_atomic_use_count_type atomic_decrement(use_count_type& pw, ::boost::d
 inline non_atomic_use_count_type atomic_conditional_increment(use_count_type& pw, ::boost::detail::sp_counted_base&) noexcept {
     return ::boost::detail::atomic_conditional_increment(&pw);
 }
+
+template<typename U>
+inline U atomic_add_fetch(::std::atomic<U>* pw, U n) noexcept {
+    return pw->fetch_add(n, ::std::memory_order_acq_rel) + n;
+}
+
+// The other implementations use a plain integer manipulated with GCC compatible builtins or inline assembly
+template<typename U>
+inline U atomic_add_fetch(U* pw, U n) noexcept {
+    return __atomic_add_fetch(pw, n, __ATOMIC_ACQ_REL);
+}
+
+template<typename U>
+inline U atomic_add_below_fetch(::std::atomic<U>* pw, U n, long limit) noexcept {
+    U current = pw->load(::std::memory_order_relaxed);
+    do {
+        if (current >= limit) return current;
+    } while (!pw->compare_exchange_weak(current, current + n, ::std::memory_order_acq_rel, ::std::memory_order_relaxed));
+    return current + n;
+}
+
+template<typename U>
+inline U atomic_add_below_fetch(U* pw, U n, long limit) noexcept {
+    U current = __atomic_load_n(pw, __ATOMIC_RELAXED);
+    do {
+        if (current >= limit) return current;
+    } while (!__atomic_compare_exchange_n(pw, &current, current + n, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return current + n;
+}
+
+inline non_atomic_use_count_type atomic_add(use_count_type& pw, non_atomic_use_count_type n, ::boost::detail::sp_counted_base&) noexcept {
+    return ::ref_counted_shared_ptr::detail::boost::atomic_add_fetch(&pw, n);
+}
+
+inline non_atomic_use_count_type atomic_add_below(use_count_type& pw, non_atomic_use_count_type n, long limit, ::boost::detail::sp_counted_base&) noexcept {
+    return ::ref_counted_shared_ptr::detail::boost::atomic_add_below_fetch(&pw, n, limit);
+}
 #endif
 
 struct pi_ : private_member<pi_, ::boost::detail::weak_count, ::boost::detail::sp_counted_base*> {};
+struct shared_pi_ : private_member<shared_pi_, ::boost::detail::shared_count, ::boost::detail::sp_counted_base*> {};
 struct use_count_ : private_member<use_count_, ::boost::detail::sp_counted_base, use_count_type> {};
 
 template<typename T>
 struct defined_private_accessors : ::std::false_type {};
+template<typename T>
+struct defined_shared_ptr_accessors : ::std::false_type {};
 
 }
 }
@@ -139,6 +234,7 @@ namespace ref_counted_shared_ptr {
 namespace detail {
 
 template struct make_private_member<boost::pi_, &::boost::detail::weak_count::pi_>;
+template struct make_private_member<boost::shared_pi_, &::boost::detail::shared_count::pi_>;
 template struct make_private_member<boost::use_count_, &::boost::detail::sp_counted_base::use_count_>;
 
 }
@@ -172,6 +268,19 @@ struct implementation_information {
         return p.*pn<T>::get_value().*::ref_counted_shared_ptr::detail::boost::pi_::get_value();
     }
 
+    template<typename T>
+    using has_shared_ptr_accessors = ::ref_counted_shared_ptr::detail::boost::defined_shared_ptr_accessors<T>;
+
+    template<typename T>
+    static typename shared_ptr<T>::element_type*& get_shared_ptr_pointer(shared_ptr<T>& p) noexcept {
+        return p.*px<T>::get_value();
+    }
+
+    template<typename T>
+    static control_block_type*& get_shared_ptr_control_block(shared_ptr<T>& p) noexcept {
+        return p.*shared_pn<T>::get_value().*::ref_counted_shared_ptr::detail::boost::shared_pi_::get_value();
+    }
+
     static atomic_count_type& get_count(control_block_type& control_block) noexcept {
         return control_block.*::ref_counted_shared_ptr::detail::boost::use_count_::get_value();
     }
@@ -188,10 +297,34 @@ struct implementation_information {
         return ::ref_counted_shared_ptr::detail::boost::atomic_conditional_increment(count, control_block) + 1;
     }
 
+    static regular_count_type conditional_increment_and_fetch(atomic_count_type& count, control_block_type& control_block) noexcept {
+        regular_count_type old_count = ::ref_counted_shared_ptr::detail::boost::atomic_conditional_increment(count, control_block);
+        return old_count == 0 ? 0 : old_count + 1;
+    }
+
     static regular_count_type decrement_and_fetch(atomic_count_type& count, control_block_type& control_block) noexcept {
         return ::ref_counted_shared_ptr::detail::boost::atomic_decrement(count, control_block) - 1;
     }
 
+    static regular_count_type add_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n) noexcept {
+        return ::ref_counted_shared_ptr::detail::boost::atomic_add(count, n, control_block);
+    }
+
+    static regular_count_type add_below_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n, long limit) noexcept {
+        return ::ref_counted_shared_ptr::detail::boost::atomic_add_below(count, n, limit, control_block);
+    }
+
+    static regular_count_type subtract_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n) noexcept {
+        // Not every control block implementation has an atomic subtract, so decrement n times
+        regular_count_type new_count = 0;
+        for (; n != 0; --n) new_count = decrement_and_fetch(count, control_block);
+        return new_count;
+    }
+
+    static void weak_increment(control_block_type& control_block) noexcept {
+        control_block.weak_add_ref();
+    }
+
     static void on_zero_references(atomic_count_type&, control_block_type& control_block) noexcept {
         control_block.add_ref_copy();
         control_block.release();
@@ -1,12 +1,49 @@
 #ifndef REF_COUNTED_SHARED_PTR_COMMON_H_
 #define REF_COUNTED_SHARED_PTR_COMMON_H_
 
+#include <atomic>
 #include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef REF_COUNTED_SHARED_PTR_TRACE
+#include "ref_counted_shared_ptr/trace.h"
+#define REF_COUNTED_SHARED_PTR_TRACE_EVENT(operation, object, count, ...) \
+::ref_counted_shared_ptr::trace::detail::record_event< __VA_ARGS__ >(::ref_counted_shared_ptr::trace::operation_type::operation, object, count)
+#else
+#define REF_COUNTED_SHARED_PTR_TRACE_EVENT(operation, object, count, ...) static_cast<void>(0)
+#endif
+
+// Hint that the memory at `address` is about to be written
+#if defined(__GNUC__) || defined(__clang__)
+#define REF_COUNTED_SHARED_PTR_PREFETCH(address) __builtin_prefetch(address, 1)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#define REF_COUNTED_SHARED_PTR_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define REF_COUNTED_SHARED_PTR_PREFETCH(address) static_cast<void>(address)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define REF_COUNTED_SHARED_PTR_UNLIKELY(condition) __builtin_expect(static_cast<bool>(condition), 0)
+#else
+#define REF_COUNTED_SHARED_PTR_UNLIKELY(condition) static_cast<bool>(condition)
+#endif
 
 
 namespace ref_counted_shared_ptr {
+
+// Reported by `use_count()`, `incref()` and `decref()` of immortal objects
+constexpr long immortal_use_count = ::std::numeric_limits<long>::max();
+
 namespace detail {
 
+// Base of external_ref_counted_shared_ptr (std and boost), whose manual references are kept in a count of its own
+// instead of the control block, so release_to_manual and adopt_manual have to go through incref() and decref()
+struct external_reference_count {};
+
 template<typename ImplementationInformation>
 struct common_implementation {
     // Required of ImplementationInformation:
@@ -40,6 +77,22 @@ struct common_implementation {
         return ImplementationInformation::get_control_block(p);
     }
 
+    // template<typename T> using has_shared_ptr_accessors = /* std::true_type if the following can be used with T */;
+    template<typename T>
+    using has_shared_ptr_accessors = typename ImplementationInformation::template has_shared_ptr_accessors<T>;
+
+    // Returns the private stored pointer of a shared_ptr<T>
+    template<typename T>
+    static typename shared_ptr<T>::element_type*& get_shared_ptr_pointer(shared_ptr<T>& p) noexcept {
+        return ImplementationInformation::get_shared_ptr_pointer(p);
+    }
+
+    // Returns the nullable pointer to the control block held by a shared_ptr<T>
+    template<typename T>
+    static control_block_type*& get_shared_ptr_control_block(shared_ptr<T>& p) noexcept {
+        return ImplementationInformation::get_shared_ptr_control_block(p);
+    }
+
     // Returns the reference count (number of shared_ptrs) stored on a control block
     static atomic_count_type& get_count(control_block_type& control_block) noexcept {
         return ImplementationInformation::get_count(control_block);
@@ -72,11 +125,39 @@ struct common_implementation {
         return ImplementationInformation::increment_and_fetch(count, control_block);
     }
 
+    // Increment count only if it is not currently 0 (adjusted the same way as fetch), and return it's new value.
+    // If count was 0, it is left unchanged and the returned value is adjusted to 0.
+    static regular_count_type conditional_increment_and_fetch(atomic_count_type& count, control_block_type& control_block) noexcept {
+        return ImplementationInformation::conditional_increment_and_fetch(count, control_block);
+    }
+
     // Decrement count and return it's current value (adjusted the same way as fetch)
     static regular_count_type decrement_and_fetch(atomic_count_type& count, control_block_type& control_block) noexcept {
         return ImplementationInformation::decrement_and_fetch(count, control_block);
     }
 
+    // Subtract n (> 0) from count and return it's current value (adjusted the same way as fetch)
+    static regular_count_type subtract_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n) noexcept {
+        return ImplementationInformation::subtract_and_fetch(count, control_block, n);
+    }
+
+    // Add n (> 0) to count and return it's current value (adjusted the same way as fetch)
+    static regular_count_type add_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n) noexcept {
+        return ImplementationInformation::add_and_fetch(count, control_block, n);
+    }
+
+    // Add n (> 0) to count only while it's use count (as returned by get_use_count) is below limit, and return it's new
+    // value (adjusted the same way as fetch). If it was not below limit, count is left unchanged and it's current value
+    // is returned.
+    static regular_count_type add_below_and_fetch(atomic_count_type& count, control_block_type& control_block, regular_count_type n, long limit) noexcept {
+        return ImplementationInformation::add_below_and_fetch(count, control_block, n, limit);
+    }
+
+    // Add one to the weak reference count (which includes one reference held by all the shared_ptrs together)
+    static void weak_increment(control_block_type& control_block) noexcept {
+        return ImplementationInformation::weak_increment(control_block);
+    }
+
     // Called when decrement_and_fetch(get_count(control_block)) returns 0 (and the object should be destroyed)
     // A valid implementation is to call the equivalent of `control_block->add_shared(); control_block->remove_shared()`
     // (No need for atomicity, since this should be called at most once per control block)
@@ -85,39 +166,206 @@ struct common_implementation {
     }
 
     // Implementation of ref_counted_shared_ptr functions:
-    template<typename T>
+    // `Traced` is only used to identify the type of the object when tracing (see ref_counted_shared_ptr/trace.h),
+    // and defaults to `T`.
+    template<typename Traced = void, typename T>
     static long incref(const enable_shared_from_this<T>& p) {
+        long new_count = incref<Traced>(p, ::std::nothrow);
+        if (new_count != 0) return new_count;
+
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(bad_weak_ptr, &p, 0, traced_type<Traced, T>);
+        throw_bad_weak_ptr<T>();
+    }
+
+    // Returns 0 instead of throwing bad_weak_ptr
+    template<typename Traced = void, typename T>
+    static long incref(const enable_shared_from_this<T>& p, const ::std::nothrow_t&) noexcept {
         control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) return 0;
+        if (REF_COUNTED_SHARED_PTR_UNLIKELY(is_immortal(*control_block))) return immortal_use_count;
 
-        if (control_block) {
-            return cast_count_to_long(increment_and_fetch(get_count(*control_block), *control_block));
-        }
+        long new_count = cast_count_to_long(increment_and_fetch(get_count(*control_block), *control_block));
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(incref, &p, new_count, traced_type<Traced, T>);
+        return new_count;
+    }
+
+    // Same as calling incref() n (> 0) times, but with a single atomic operation
+    template<typename Traced = void, typename T>
+    static long incref(const enable_shared_from_this<T>& p, long n) {
+        long new_count = incref<Traced>(p, n, ::std::nothrow);
+        if (new_count != 0) return new_count;
 
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(bad_weak_ptr, &p, 0, traced_type<Traced, T>);
         throw_bad_weak_ptr<T>();
     }
 
-    template<typename T>
-    static long decref(const enable_shared_from_this<T>& p) {
+    template<typename Traced = void, typename T>
+    static long incref(const enable_shared_from_this<T>& p, long n, const ::std::nothrow_t&) noexcept {
         control_block_type* control_block = get_control_block(get_weak_ptr(p));
-        if (control_block) {
-            atomic_count_type& count = get_count(*control_block);
-            long new_count = cast_count_to_long(decrement_and_fetch(count, *control_block));
-            if (new_count != 0) return new_count;
+        if (!control_block) return 0;
+        if (REF_COUNTED_SHARED_PTR_UNLIKELY(is_immortal(*control_block))) return immortal_use_count;
 
-            on_zero_references(count, *control_block);
-            return 0;
+        long new_count = cast_count_to_long(add_and_fetch(get_count(*control_block), *control_block, static_cast<regular_count_type>(n)));
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(incref, &p, new_count, traced_type<Traced, T>);
+        return new_count;
+    }
+
+    // Returns 0 if there is no control block or the reference count has already reached 0
+    template<typename Traced = void, typename T>
+    static long try_incref(const enable_shared_from_this<T>& p) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) return 0;
+        if (REF_COUNTED_SHARED_PTR_UNLIKELY(is_immortal(*control_block))) return immortal_use_count;
+
+        long new_count = cast_count_to_long(conditional_increment_and_fetch(get_count(*control_block), *control_block));
+        if (new_count == 0) {
+            REF_COUNTED_SHARED_PTR_TRACE_EVENT(try_incref_failed, &p, 0, traced_type<Traced, T>);
+        } else {
+            REF_COUNTED_SHARED_PTR_TRACE_EVENT(incref, &p, new_count, traced_type<Traced, T>);
         }
+        return new_count;
+    }
+
+    template<typename Traced = void, typename T>
+    static long decref(const enable_shared_from_this<T>& p) {
+        long new_count = decref<Traced>(p, ::std::nothrow);
+        if (new_count >= 0) return new_count;
 
         // Immediately called decref() before constructing a shared_ptr or calling incref
         // Or called decref() after &p was already deleted (which is UB anyways)
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(bad_weak_ptr, &p, 0, traced_type<Traced, T>);
+        throw_bad_weak_ptr<T>();
+    }
+
+    // Returns -1 instead of throwing bad_weak_ptr
+    template<typename Traced = void, typename T>
+    static long decref(const enable_shared_from_this<T>& p, const ::std::nothrow_t&) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) return -1;
+        if (REF_COUNTED_SHARED_PTR_UNLIKELY(is_immortal(*control_block))) return immortal_use_count;
+
+        atomic_count_type& count = get_count(*control_block);
+        long new_count = cast_count_to_long(decrement_and_fetch(count, *control_block));
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(decref, &p, new_count, traced_type<Traced, T>);
+        if (new_count != 0) return new_count;
+
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(zero_references, &p, 0, traced_type<Traced, T>);
+        on_zero_references(count, *control_block);
+        return 0;
+    }
+
+    // Same as calling decref() n (> 0) times, but with a single atomic operation
+    template<typename Traced = void, typename T>
+    static long decref(const enable_shared_from_this<T>& p, long n) {
+        long new_count = decref<Traced>(p, n, ::std::nothrow);
+        if (new_count >= 0) return new_count;
+
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(bad_weak_ptr, &p, 0, traced_type<Traced, T>);
         throw_bad_weak_ptr<T>();
     }
 
+    template<typename Traced = void, typename T>
+    static long decref(const enable_shared_from_this<T>& p, long n, const ::std::nothrow_t&) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) return -1;
+        if (REF_COUNTED_SHARED_PTR_UNLIKELY(is_immortal(*control_block))) return immortal_use_count;
+
+        atomic_count_type& count = get_count(*control_block);
+        long new_count = cast_count_to_long(subtract_and_fetch(count, *control_block, static_cast<regular_count_type>(n)));
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(decref, &p, new_count, traced_type<Traced, T>);
+        if (new_count != 0) return new_count;
+
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(zero_references, &p, 0, traced_type<Traced, T>);
+        on_zero_references(count, *control_block);
+        return 0;
+    }
+
     template<typename T>
     static long use_count(const enable_shared_from_this<T>& p) noexcept {
         control_block_type* control_block = get_control_block(get_weak_ptr(p));
         if (!control_block) return 0;
-        return get_use_count(*control_block);
+        long count = get_use_count(*control_block);
+        return count >= immortal_threshold ? immortal_use_count : count;
+    }
+
+    // Whether the caller's reference (a shared_ptr or a manual reference) is the only one. Unlike use_count(), this
+    // is exact, unless another thread can make a new reference from a weak_ptr or with try_incref(). The acquire
+    // fence synchronizes with the release of the other references, so their writes to `p` are visible.
+    template<typename T>
+    static bool is_unique(const enable_shared_from_this<T>& p) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block || get_use_count(*control_block) != 1) return false;
+        ::std::atomic_thread_fence(::std::memory_order_acquire);
+        return true;
+    }
+
+    // Adds immortal_count references that are never removed, so the object is never destroyed and
+    // incref() / decref() no longer modify the reference count. Calling this again has no effect.
+    template<typename T>
+    static void make_immortal(const enable_shared_from_this<T>& p) {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) throw_bad_weak_ptr<T>();
+        // Racing calls must not both add immortal_count, since two of them overflow a 32 bit count, so only add it
+        // while the count is below immortal_threshold
+        if (!is_immortal(*control_block)) add_below_and_fetch(get_count(*control_block), *control_block, static_cast<regular_count_type>(immortal_count), immortal_threshold);
+    }
+
+    template<typename T>
+    static bool is_immortal(const enable_shared_from_this<T>& p) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        return control_block && is_immortal(*control_block);
+    }
+
+    template<typename T>
+    static void prefetch_count(const enable_shared_from_this<T>& p) noexcept {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (control_block) REF_COUNTED_SHARED_PTR_PREFETCH(&get_count(*control_block));
+    }
+
+    // Moves the reference owned by `owner` (which points to `p`) to the manual reference count of `p`, leaving `owner`
+    // empty. Does not modify the reference count unless `owner` shares ownership with a different control block.
+    template<typename Traced = void, typename T, typename U>
+    static void release_to_manual(const enable_shared_from_this<T>& p, shared_ptr<U>& owner) {
+        static_assert(has_shared_ptr_accessors<const void>::value, "ref_counted_shared_ptr: The shared_ptr accessors for const void have not been defined");
+
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) {
+            REF_COUNTED_SHARED_PTR_TRACE_EVENT(bad_weak_ptr, &p, 0, traced_type<Traced, T>);
+            throw_bad_weak_ptr<T>();
+        }
+
+        shared_ptr<const void> moved(::std::move(owner));
+        control_block_type*& moved_control_block = get_shared_ptr_control_block(moved);
+        if (moved_control_block != control_block) {
+            // An aliasing shared_ptr. `moved` keeps `p` alive until the new reference is taken.
+            incref<Traced>(p, ::std::nothrow);
+            return;
+        }
+        get_shared_ptr_pointer(moved) = nullptr;
+        moved_control_block = nullptr;
+    }
+
+    // Returns a shared_ptr<U> to `object` (whose enable_shared_from_this base is `p`) which owns one of the manual
+    // references of `p`. Does not modify the reference count if there are shared_ptr accessors for U, or if
+    // shared_ptr<U> can be move constructed with the aliasing constructor (C++20, boost). Otherwise the aliasing
+    // constructor copies, which increments and decrements the reference count once.
+    template<typename T, typename U>
+    static shared_ptr<U> adopt_manual(const enable_shared_from_this<T>& p, U* object) {
+        control_block_type* control_block = get_control_block(get_weak_ptr(p));
+        if (!control_block) throw_bad_weak_ptr<T>();
+        return adopt_control_block(control_block, object, has_shared_ptr_accessors<U>());
+    }
+
+    // Gives one reference to an object whose reference count reached 0 without the object or its control block being
+    // destroyed (because its deleter did not destroy it, see ref_counted_shared_ptr/recycling.h), as if the
+    // control block was new. `p` must have a control block and nothing else may be using it.
+    template<typename Traced = void, typename T>
+    static void revive(const enable_shared_from_this<T>& p) noexcept {
+        control_block_type& control_block = *get_control_block(get_weak_ptr(p));
+        add_and_fetch(get_count(control_block), control_block, 1);
+        // Releasing the last reference also released the weak reference held by the owners
+        weak_increment(control_block);
+        REF_COUNTED_SHARED_PTR_TRACE_EVENT(incref, &p, 1, traced_type<Traced, T>);
     }
 
     template<typename T>
@@ -126,12 +374,44 @@ struct common_implementation {
     }
 
     template<typename T>
-    static weak_ptr<const T>& weak_from_this(const enable_shared_from_this<T>& p) noexcept {
+    static weak_ptr<const T> weak_from_this(const enable_shared_from_this<T>& p) noexcept {
         return get_weak_ptr(p);
     }
 
     // Helpers
 private:
+    // Added to the reference count by make_immortal(). Counts at or above immortal_threshold are considered
+    // immortal, so there is room for 2**29 references that were taken before the object became immortal
+    // (or shared_ptr copies, which still change the count) to be released without it becoming mortal again,
+    // and the count still fits in 32 bits.
+    static constexpr long immortal_count = 1L << 30;
+    static constexpr long immortal_threshold = 1L << 29;
+
+    // A relaxed load, checked before every read-modify-write so that immortal objects' control blocks are never written
+    static bool is_immortal(control_block_type& control_block) noexcept {
+        return get_use_count(control_block) >= immortal_threshold;
+    }
+
+    template<typename Traced, typename T>
+    using traced_type = typename ::std::conditional<::std::is_void<Traced>::value, T, Traced>::type;
+
+    template<typename U>
+    static shared_ptr<U> adopt_control_block(control_block_type* control_block, U* object, ::std::true_type) noexcept {
+        shared_ptr<U> result;
+        get_shared_ptr_pointer(result) = object;
+        get_shared_ptr_control_block(result) = control_block;
+        return result;
+    }
+
+    template<typename U>
+    static shared_ptr<U> adopt_control_block(control_block_type* control_block, U* object, ::std::false_type) noexcept {
+        shared_ptr<const void> owner;
+        get_shared_ptr_pointer(owner) = object;
+        get_shared_ptr_control_block(owner) = control_block;
+        // Before C++20, this copies `owner` instead
+        return shared_ptr<U>(::std::move(owner), object);
+    }
+
     template<typename T>
     [[noreturn]] static void throw_bad_weak_ptr() {
         static_cast<void>(shared_ptr<const T>(weak_ptr<const T>()));
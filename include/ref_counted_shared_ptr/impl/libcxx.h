@@ -21,6 +21,18 @@ template struct ref_counted_shared_ptr::detail::make_private_member<
 >;                                                                                  \
                                                                                     \
 template<> struct ref_counted_shared_ptr::detail::std::libcxx::defined_private_accessors< __VA_ARGS__ > : ::std::true_type {}
+#define REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_STD(...)                 \
+template struct ref_counted_shared_ptr::detail::make_private_member<                \
+    ::ref_counted_shared_ptr::detail::std::libcxx::_ptr_< __VA_ARGS__ >,            \
+    &::std::shared_ptr< __VA_ARGS__ >::__ptr_                                       \
+>;                                                                                  \
+                                                                                    \
+template struct ref_counted_shared_ptr::detail::make_private_member<                \
+    ::ref_counted_shared_ptr::detail::std::libcxx::_shared_cntrl_< __VA_ARGS__ >,   \
+    &::std::shared_ptr< __VA_ARGS__ >::__cntrl_                                     \
+>;                                                                                  \
+                                                                                    \
+template<> struct ref_counted_shared_ptr::detail::std::libcxx::defined_shared_ptr_accessors< __VA_ARGS__ > : ::std::true_type {}
 
 #include "ref_counted_shared_ptr/impl/redefine_macro.h"
 
@@ -34,6 +46,10 @@ template<typename T>
 struct _weak_this_ : private_member<_weak_this_<T>, ::std::enable_shared_from_this<T>, ::std::weak_ptr<T>> {};
 template<typename T>
 struct _cntrl_ : private_member<_cntrl_<T>, ::std::weak_ptr<T>, ::std::__shared_weak_count*> {};
+template<typename T>
+struct _ptr_ : private_member<_ptr_<T>, ::std::shared_ptr<T>, typename ::std::shared_ptr<T>::element_type*> {};
+template<typename T>
+struct _shared_cntrl_ : private_member<_shared_cntrl_<T>, ::std::shared_ptr<T>, ::std::__shared_weak_count*> {};
 
 static_assert(::std::is_base_of<::std::__shared_count, ::std::__shared_weak_count>::value, "libc++ implementation of weak_ptr incompatible with what is expected by ref_counted_shared_ptr");
 struct _shared_owners_ : private_member<_shared_owners_, ::std::__shared_count, long> {};
@@ -43,6 +59,8 @@ struct _on_zero_shared : private_member<_on_zero_shared, ::std::__shared_count,
 
 template<typename T>
 struct defined_private_accessors : ::std::false_type {};
+template<typename T>
+struct defined_shared_ptr_accessors : ::std::false_type {};
 
 }
 }
@@ -98,6 +116,19 @@ struct implementation_information {
         return p.*::ref_counted_shared_ptr::detail::std::libcxx::_cntrl_<T>::get_value();
     }
 
+    template<typename T>
+    using has_shared_ptr_accessors = ::ref_counted_shared_ptr::detail::std::libcxx::defined_shared_ptr_accessors<T>;
+
+    template<typename T>
+    static typename shared_ptr<T>::element_type*& get_shared_ptr_pointer(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::libcxx::_ptr_<T>::get_value();
+    }
+
+    template<typename T>
+    static control_block_type*& get_shared_ptr_control_block(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::libcxx::_shared_cntrl_<T>::get_value();
+    }
+
     static atomic_count_type& get_count(control_block_type& control_block) noexcept {
         return upcast_control_block(control_block).*::ref_counted_shared_ptr::detail::std::libcxx::_shared_owners_::get_value();
     }
@@ -114,12 +145,44 @@ struct implementation_information {
         return ::std::__libcpp_atomic_refcount_increment(count);
     }
 
+    static regular_count_type conditional_increment_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
+        // Same as __shared_weak_count::lock, but returns the new count
+        long current = ::std::__libcpp_atomic_load(&count);
+        while (current != -1) {
+            if (::std::__libcpp_atomic_compare_exchange(&count, &current, current + 1)) return current + 1;
+        }
+        return -1;
+    }
+
     static regular_count_type decrement_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
         return ::std::__libcpp_atomic_refcount_decrement(count);
     }
 
+    static regular_count_type add_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return ::std::__libcpp_atomic_add(&count, n, ::std::_AO_Acq_Rel);
+    }
+
+    static regular_count_type add_below_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n, long limit) noexcept {
+        // count is one less than the use count
+        long current = ::std::__libcpp_atomic_load(&count);
+        while (current + 1 < limit) {
+            if (::std::__libcpp_atomic_compare_exchange(&count, &current, current + n)) return current + n;
+        }
+        return current;
+    }
+
+    static regular_count_type subtract_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return ::std::__libcpp_atomic_add(&count, -n, ::std::_AO_Acq_Rel);
+    }
+
+    static void weak_increment(control_block_type& control_block) noexcept {
+        control_block.__add_weak();
+    }
+
     static void on_zero_references(atomic_count_type&, control_block_type& control_block) noexcept {
         (upcast_control_block(control_block).*::ref_counted_shared_ptr::detail::std::libcxx::_on_zero_shared::get_value())();
+        // Same as the rest of __shared_weak_count::__release_shared, releasing the weak reference held by the owners
+        control_block.__release_weak();
     }
 };
 
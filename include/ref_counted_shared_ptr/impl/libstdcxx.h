@@ -21,6 +21,18 @@ template struct ref_counted_shared_ptr::detail::make_private_member<
 >;                                                                                  \
                                                                                     \
 template<> struct ref_counted_shared_ptr::detail::std::libstdcxx::defined_private_accessors< __VA_ARGS__ > : ::std::true_type {}
+#define REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_STD(...)                        \
+template struct ref_counted_shared_ptr::detail::make_private_member<                       \
+    ::ref_counted_shared_ptr::detail::std::libstdcxx::_m_ptr< __VA_ARGS__ >,               \
+    &::std::__shared_ptr< __VA_ARGS__ >::_M_ptr                                            \
+>;                                                                                         \
+                                                                                           \
+template struct ref_counted_shared_ptr::detail::make_private_member<                       \
+    ::ref_counted_shared_ptr::detail::std::libstdcxx::_m_shared_refcount< __VA_ARGS__ >,   \
+    &::std::__shared_ptr< __VA_ARGS__ >::_M_refcount                                       \
+>;                                                                                         \
+                                                                                           \
+template<> struct ref_counted_shared_ptr::detail::std::libstdcxx::defined_shared_ptr_accessors< __VA_ARGS__ > : ::std::true_type {}
 
 #include "ref_counted_shared_ptr/impl/redefine_macro.h"
 
@@ -35,10 +47,17 @@ struct _m_weak_this : private_member<_m_weak_this<T>, ::std::enable_shared_from_
 template<typename T>
 struct _m_refcount : private_member<_m_refcount<T>, ::std::__weak_ptr<T>, ::std::__weak_count<>> {};
 struct _m_pi : private_member<_m_pi, ::std::__weak_count<>, ::std::_Sp_counted_base<>*> {};
+template<typename T>
+struct _m_ptr : private_member<_m_ptr<T>, ::std::__shared_ptr<T>, typename ::std::__shared_ptr<T>::element_type*> {};
+template<typename T>
+struct _m_shared_refcount : private_member<_m_shared_refcount<T>, ::std::__shared_ptr<T>, ::std::__shared_count<>> {};
+struct _m_shared_pi : private_member<_m_shared_pi, ::std::__shared_count<>, ::std::_Sp_counted_base<>*> {};
 struct _m_use_count : private_member<_m_use_count, ::std::_Sp_counted_base<>, ::_Atomic_word> {};
 
 template<typename T>
 struct defined_private_accessors : ::std::false_type {};
+template<typename T>
+struct defined_shared_ptr_accessors : ::std::false_type {};
 
 }
 }
@@ -49,6 +68,7 @@ namespace ref_counted_shared_ptr {
 namespace detail {
 
 template struct make_private_member<std::libstdcxx::_m_pi, &::std::__weak_count<>::_M_pi>;
+template struct make_private_member<std::libstdcxx::_m_shared_pi, &::std::__shared_count<>::_M_pi>;
 template struct make_private_member<std::libstdcxx::_m_use_count, &::std::_Sp_counted_base<>::_M_use_count>;
 
 }
@@ -82,6 +102,19 @@ struct implementation_information {
         return p.*::ref_counted_shared_ptr::detail::std::libstdcxx::_m_refcount<T>::get_value().*libstdcxx::_m_pi::get_value();
     }
 
+    template<typename T>
+    using has_shared_ptr_accessors = ::ref_counted_shared_ptr::detail::std::libstdcxx::defined_shared_ptr_accessors<T>;
+
+    template<typename T>
+    static typename shared_ptr<T>::element_type*& get_shared_ptr_pointer(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::libstdcxx::_m_ptr<T>::get_value();
+    }
+
+    template<typename T>
+    static control_block_type*& get_shared_ptr_control_block(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::libstdcxx::_m_shared_refcount<T>::get_value().*libstdcxx::_m_shared_pi::get_value();
+    }
+
     static atomic_count_type& get_count(control_block_type& control_block) noexcept {
         return control_block.*::ref_counted_shared_ptr::detail::std::libstdcxx::_m_use_count::get_value();
     }
@@ -98,10 +131,39 @@ struct implementation_information {
         return ::__gnu_cxx::__exchange_and_add(&count, +1) + 1;
     }
 
+    static regular_count_type conditional_increment_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
+        // Same as _Sp_counted_base<_S_atomic>::_M_add_ref_lock_nothrow, but returns the new count
+        atomic_count_type current = __atomic_load_n(&count, __ATOMIC_RELAXED);
+        do {
+            if (current == 0) return 0;
+        } while (!__atomic_compare_exchange_n(&count, &current, current + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+        return static_cast<regular_count_type>(current) + 1;
+    }
+
     static regular_count_type decrement_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
         return ::__gnu_cxx::__exchange_and_add(&count, -1) - 1;
     }
 
+    static regular_count_type add_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return ::__gnu_cxx::__exchange_and_add(&count, static_cast<atomic_count_type>(n)) + n;
+    }
+
+    static regular_count_type add_below_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n, long limit) noexcept {
+        atomic_count_type current = __atomic_load_n(&count, __ATOMIC_RELAXED);
+        do {
+            if (current >= limit) return current;
+        } while (!__atomic_compare_exchange_n(&count, &current, static_cast<atomic_count_type>(current + n), true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+        return static_cast<regular_count_type>(current) + n;
+    }
+
+    static regular_count_type subtract_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return ::__gnu_cxx::__exchange_and_add(&count, static_cast<atomic_count_type>(-n)) - n;
+    }
+
+    static void weak_increment(control_block_type& control_block) noexcept {
+        control_block._M_weak_add_ref();
+    }
+
     static void on_zero_references(atomic_count_type&, control_block_type& control_block) noexcept {
         control_block._M_add_ref_copy();
         control_block._M_release();
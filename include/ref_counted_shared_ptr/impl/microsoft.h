@@ -21,6 +21,19 @@ template struct ref_counted_shared_ptr::detail::make_private_member<         \
                                                                              \
 template<>                                                                   \
 struct ref_counted_shared_ptr::detail::std::microsoft::defined_private_accessors< __VA_ARGS__ > : ::std::true_type {}
+#define REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_STD(...)             \
+template struct ref_counted_shared_ptr::detail::make_private_member<            \
+    ::ref_counted_shared_ptr::detail::std::microsoft::_ptr< __VA_ARGS__ >,      \
+    &::std::_Ptr_base< __VA_ARGS__ >::_Ptr                                      \
+>;                                                                              \
+                                                                                \
+template struct ref_counted_shared_ptr::detail::make_private_member<            \
+    ::ref_counted_shared_ptr::detail::std::microsoft::_shared_rep< __VA_ARGS__ >, \
+    &::std::_Ptr_base< __VA_ARGS__ >::_Rep                                      \
+>;                                                                              \
+                                                                                \
+template<>                                                                      \
+struct ref_counted_shared_ptr::detail::std::microsoft::defined_shared_ptr_accessors< __VA_ARGS__ > : ::std::true_type {}
 
 #include "ref_counted_shared_ptr/impl/redefine_macro.h"
 
@@ -34,10 +47,17 @@ template<typename T>
 struct _wptr : private_member<_wptr<T>, ::std::enable_shared_from_this<T>, ::std::weak_ptr<T>> {};
 template<typename T>
 struct _rep : private_member<_rep<T>, ::std::_Ptr_base<T>, ::std::_Ref_count_base*> {};
+template<typename T>
+struct _ptr : private_member<_ptr<T>, ::std::_Ptr_base<T>, typename ::std::_Ptr_base<T>::element_type*> {};
+// The same member as _rep, but defined separately so that shared_ptr accessors can be defined on their own
+template<typename T>
+struct _shared_rep : private_member<_shared_rep<T>, ::std::_Ptr_base<T>, ::std::_Ref_count_base*> {};
 struct _uses : private_member<_uses, ::std::_Ref_count_base, ::std::_Atomic_counter_t> {};
 
 template<typename T>
 struct defined_private_accessors : ::std::false_type {};
+template<typename T>
+struct defined_shared_ptr_accessors : ::std::false_type {};
 
 }
 }
@@ -80,6 +100,19 @@ struct implementation_information {
         return p.*::ref_counted_shared_ptr::detail::std::microsoft::_rep<T>::get_value();
     }
 
+    template<typename T>
+    using has_shared_ptr_accessors = ::ref_counted_shared_ptr::detail::std::microsoft::defined_shared_ptr_accessors<T>;
+
+    template<typename T>
+    static typename shared_ptr<T>::element_type*& get_shared_ptr_pointer(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::microsoft::_ptr<T>::get_value();
+    }
+
+    template<typename T>
+    static control_block_type*& get_shared_ptr_control_block(shared_ptr<T>& p) noexcept {
+        return p.*::ref_counted_shared_ptr::detail::std::microsoft::_shared_rep<T>::get_value();
+    }
+
     static atomic_count_type& get_count(control_block_type& control_block) noexcept {
         return control_block.*::ref_counted_shared_ptr::detail::std::microsoft::_uses::get_value();
     }
@@ -96,10 +129,45 @@ struct implementation_information {
         return _MT_INCR(count);
     }
 
+    static regular_count_type conditional_increment_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
+        // Same as _Ref_count_base::_Incref_nz, but returns the new count
+        auto& volatile_count = reinterpret_cast<volatile long&>(count);
+        long current = __iso_volatile_load32(reinterpret_cast<volatile int*>(&volatile_count));
+        while (current != 0) {
+            const long old_value = _InterlockedCompareExchange(&volatile_count, current + 1, current);
+            if (old_value == current) return current + 1;
+            current = old_value;
+        }
+        return 0;
+    }
+
     static regular_count_type decrement_and_fetch(atomic_count_type& count, control_block_type&) noexcept {
         return _MT_DECR(count);
     }
 
+    static regular_count_type add_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(&count), n) + n;
+    }
+
+    static regular_count_type add_below_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n, long limit) noexcept {
+        auto& volatile_count = reinterpret_cast<volatile long&>(count);
+        long current = __iso_volatile_load32(reinterpret_cast<volatile int*>(&volatile_count));
+        while (current < limit) {
+            const long old_value = _InterlockedCompareExchange(&volatile_count, current + n, current);
+            if (old_value == current) return current + n;
+            current = old_value;
+        }
+        return current;
+    }
+
+    static regular_count_type subtract_and_fetch(atomic_count_type& count, control_block_type&, regular_count_type n) noexcept {
+        return _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(&count), -n) - n;
+    }
+
+    static void weak_increment(control_block_type& control_block) noexcept {
+        control_block._Incwref();
+    }
+
     static void on_zero_references(atomic_count_type&, control_block_type& control_block) noexcept {
         control_block._Incref();
         control_block._Decref();
@@ -0,0 +1,150 @@
+#ifndef REF_COUNTED_SHARED_PTR_INTERN_TABLE_H_
+#define REF_COUNTED_SHARED_PTR_INTERN_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+#include "ref_counted_shared_ptr/std.h"
+
+
+namespace ref_counted_shared_ptr {
+
+// Concurrent table of unique immutable `T`s (deriving from std::ref_counted_shared_ptr<T>, constructible from a
+// `const Key&` and with a `const Key& key() const` member function), split into independently locked shards by the
+// hash of the key. The table does not own its entries: when the reference count of an entry reaches 0, its deleter
+// removes it from the table before destroying it, so there are no expired entries to sweep.
+// The table must outlive every object it makes.
+// Only supports std::shared_ptr, since objects are made with std::shared_ptr and an unlinking deleter.
+template<typename Key, typename T, typename Hash = ::std::hash<Key>, typename KeyEqual = ::std::equal_to<Key>>
+class intern_table {
+public:
+    using key_type = Key;
+    using handle = ref_counted_ptr<T>;
+
+    explicit intern_table(::std::size_t shard_count = 16, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : shards(new shard[shard_count ? shard_count : 1]), shard_count(shard_count ? shard_count : 1), hash(hash) {
+        for (::std::size_t i = 0; i < this->shard_count; ++i) shards[i].index = index_type(0, key_hash{hash}, key_equal{equal});
+    }
+
+    intern_table(const intern_table&) = delete;
+    intern_table& operator=(const intern_table&) = delete;
+
+    ~intern_table() = default;
+
+    // Returns the object for `key`, making a new `T(key)` if there is none (or if it is being destroyed)
+    handle intern(const Key& key) {
+        ::std::size_t key_hash_value = hash(key);
+        shard& s = shard_for(key_hash_value);
+        {
+            ::std::lock_guard<::std::mutex> lock(s.mutex);
+            handle existing = find_locked(s, key);
+            if (existing) return existing;
+        }
+
+        // Construct outside of the lock, so that T's constructor can intern other values
+        handle made(::ref_counted_shared_ptr::std::release_to_manual(::std::shared_ptr<T>(new T(key), unlinking_deleter{this})), adopt_ref);
+        handle existing;
+        {
+            ::std::lock_guard<::std::mutex> lock(s.mutex);
+            existing = find_locked(s, key);
+            if (!existing) {
+                s.index.emplace(::std::cref(made->key()), made.get());
+                return made;
+            }
+        }
+        // Another thread interned the same key first. Ours is destroyed (unlinking nothing) after unlocking.
+        return existing;
+    }
+
+    // Returns the object for `key`, or null if there is none
+    handle find(const Key& key) const {
+        shard& s = shard_for(hash(key));
+        ::std::lock_guard<::std::mutex> lock(s.mutex);
+        return find_locked(s, key);
+    }
+
+    // Number of entries, including ones being destroyed
+    ::std::size_t size() const {
+        ::std::size_t result = 0;
+        for (::std::size_t i = 0; i < shard_count; ++i) {
+            ::std::lock_guard<::std::mutex> lock(shards[i].mutex);
+            result += shards[i].index.size();
+        }
+        return result;
+    }
+
+private:
+    struct key_hash {
+        Hash hash;
+        ::std::size_t operator()(::std::reference_wrapper<const Key> key) const {
+            return hash(key.get());
+        }
+    };
+
+    struct key_equal {
+        KeyEqual equal;
+        bool operator()(::std::reference_wrapper<const Key> a, ::std::reference_wrapper<const Key> b) const {
+            return equal(a.get(), b.get());
+        }
+    };
+
+    // Keys refer to the `key()` of the object in the entry
+    using index_type = ::std::unordered_map<::std::reference_wrapper<const Key>, T*, key_hash, key_equal>;
+
+    struct shard {
+        ::std::mutex mutex;
+        index_type index;
+        // Keep shards on separate cache lines
+        char padding[64];
+    };
+
+    // Called by the control block when the reference count reaches 0
+    struct unlinking_deleter {
+        intern_table* table;
+
+        void operator()(T* p) const noexcept {
+            table->unlink(p);
+            delete p;
+        }
+    };
+
+    ::std::unique_ptr<shard[]> shards;
+    ::std::size_t shard_count;
+    Hash hash;
+
+    shard& shard_for(::std::size_t key_hash_value) const noexcept {
+        // Mix the bits, since the shard index and the unordered_map bucket would otherwise both use the low bits
+        ::std::uint64_t mixed = static_cast<::std::uint64_t>(key_hash_value) * UINT64_C(0x9E3779B97F4A7C15);
+        return shards[static_cast<::std::size_t>(mixed >> 32) % shard_count];
+    }
+
+    // Called with s.mutex locked. An entry whose reference count already reached 0 is removed, so that a new object
+    // can take its place. Its deleter, waiting for the lock, then leaves the new entry alone.
+    static handle find_locked(shard& s, const Key& key) {
+        auto it = s.index.find(::std::cref(key));
+        if (it == s.index.end()) return handle();
+        T* p = it->second;
+        if (::ref_counted_shared_ptr::detail::access::try_incref(*p) != 0) return handle(p, adopt_ref);
+        s.index.erase(it);
+        return handle();
+    }
+
+    void unlink(T* p) noexcept {
+        const Key& key = p->key();
+        shard& s = shard_for(hash(key));
+        ::std::lock_guard<::std::mutex> lock(s.mutex);
+        auto it = s.index.find(::std::cref(key));
+        if (it != s.index.end() && it->second == p) s.index.erase(it);
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_INTERN_TABLE_H_
@@ -0,0 +1,234 @@
+#ifndef REF_COUNTED_SHARED_PTR_LRU_CACHE_H_
+#define REF_COUNTED_SHARED_PTR_LRU_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+
+namespace ref_counted_shared_ptr {
+
+enum class eviction_policy {
+    // Evict the least recently used entries until the shard is within its budget
+    lru,
+    // Same as lru, but never evict entries whose object has references from outside the cache
+    // (`use_count() > 1`). A shard can go over budget if all of its entries are in use.
+    pinned_aware
+};
+
+struct lru_cache_statistics {
+    ::std::uint64_t hits;
+    ::std::uint64_t misses;
+    ::std::uint64_t insertions;
+    ::std::uint64_t evictions;
+    ::std::size_t entries;
+    ::std::size_t charge;
+};
+
+// Concurrent cache of `T`s (deriving from ref_counted_shared_ptr<T>), split into independently locked shards by the
+// hash of the key. The cache owns one `incref()` reference per entry and `decref()`s it on eviction, so objects
+// returned from `find` stay alive for as long as the caller holds the handle, even after being evicted.
+template<typename Key, typename T, typename Hash = ::std::hash<Key>, typename KeyEqual = ::std::equal_to<Key>>
+class sharded_lru_cache {
+public:
+    using key_type = Key;
+    using handle = ref_counted_ptr<T>;
+
+    // `memory_budget` is the maximum total charge of all entries, split evenly between `shard_count` shards
+    explicit sharded_lru_cache(::std::size_t memory_budget, ::std::size_t shard_count = 16, eviction_policy policy = eviction_policy::lru, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : shards(new shard[shard_count ? shard_count : 1]), shard_count(shard_count ? shard_count : 1), policy(policy), hash(hash) {
+        ::std::size_t shard_budget = memory_budget / this->shard_count;
+        for (::std::size_t i = 0; i < this->shard_count; ++i) {
+            shards[i].budget = shard_budget ? shard_budget : 1;
+            shards[i].index = index_type(0, hash, equal);
+        }
+    }
+
+    sharded_lru_cache(const sharded_lru_cache&) = delete;
+    sharded_lru_cache& operator=(const sharded_lru_cache&) = delete;
+
+    ~sharded_lru_cache() {
+        clear();
+    }
+
+    // Returns a handle pinning the cached object and marks it as most recently used, or a null handle on a miss
+    handle find(const Key& key) {
+        ::std::size_t key_hash = hash(key);
+        shard& s = shard_for(key_hash);
+        ::std::lock_guard<::std::mutex> lock(s.mutex);
+        auto it = s.index.find(key);
+        if (it == s.index.end()) {
+            s.misses.fetch_add(1, ::std::memory_order_relaxed);
+            return handle();
+        }
+        s.hits.fetch_add(1, ::std::memory_order_relaxed);
+        s.entries.splice(s.entries.begin(), s.entries, it->second);
+        return share(it->second->value);
+    }
+
+    // Caches `value` (which is `incref()`ed, possibly throwing bad_weak_ptr) under `key`, replacing any existing entry.
+    // Returns a handle to `value`.
+    handle insert(const Key& key, T* value, ::std::size_t charge = 1) {
+        return insert(key, handle(value), charge);
+    }
+
+    // Caches `value`, taking over its reference
+    handle insert(const Key& key, handle value, ::std::size_t charge = 1) {
+        if (!value) return handle();
+        handle result = share(value.get());
+        ::std::vector<T*> released;
+        {
+            ::std::size_t key_hash = hash(key);
+            shard& s = shard_for(key_hash);
+            ::std::lock_guard<::std::mutex> lock(s.mutex);
+            auto it = s.index.find(key);
+            if (it != s.index.end()) {
+                released.push_back(it->second->value);
+                s.charge -= it->second->charge;
+                it->second->value = value.release();
+                it->second->charge = charge;
+                s.entries.splice(s.entries.begin(), s.entries, it->second);
+            } else {
+                s.entries.push_front(entry{key, value.get(), charge});
+                try {
+                    s.index.emplace(key, s.entries.begin());
+                } catch (...) {
+                    s.entries.pop_front();
+                    throw;
+                }
+                value.release();
+            }
+            s.charge += charge;
+            s.insertions.fetch_add(1, ::std::memory_order_relaxed);
+            evict(s, released);
+        }
+        // Destroying objects can run arbitrary code (including using this cache), so only do it after unlocking
+        release_all(released);
+        return result;
+    }
+
+    // Removes the entry for `key`. Returns false if there was none.
+    bool erase(const Key& key) {
+        T* released;
+        {
+            ::std::size_t key_hash = hash(key);
+            shard& s = shard_for(key_hash);
+            ::std::lock_guard<::std::mutex> lock(s.mutex);
+            auto it = s.index.find(key);
+            if (it == s.index.end()) return false;
+            released = it->second->value;
+            s.charge -= it->second->charge;
+            s.entries.erase(it->second);
+            s.index.erase(it);
+        }
+        ::ref_counted_shared_ptr::detail::access::decref(*released, ::std::nothrow);
+        return true;
+    }
+
+    void clear() {
+        for (::std::size_t i = 0; i < shard_count; ++i) {
+            shard& s = shards[i];
+            list_type entries;
+            {
+                ::std::lock_guard<::std::mutex> lock(s.mutex);
+                s.index.clear();
+                entries.swap(s.entries);
+                s.charge = 0;
+            }
+            for (entry& e : entries) ::ref_counted_shared_ptr::detail::access::decref(*e.value, ::std::nothrow);
+        }
+    }
+
+    // Counters are updated with relaxed atomics, so the totals may be slightly out of date
+    lru_cache_statistics statistics() const {
+        lru_cache_statistics result = {};
+        for (::std::size_t i = 0; i < shard_count; ++i) {
+            shard& s = shards[i];
+            result.hits += s.hits.load(::std::memory_order_relaxed);
+            result.misses += s.misses.load(::std::memory_order_relaxed);
+            result.insertions += s.insertions.load(::std::memory_order_relaxed);
+            result.evictions += s.evictions.load(::std::memory_order_relaxed);
+            ::std::lock_guard<::std::mutex> lock(s.mutex);
+            result.entries += s.index.size();
+            result.charge += s.charge;
+        }
+        return result;
+    }
+
+private:
+    struct entry {
+        Key key;
+        T* value;
+        ::std::size_t charge;
+    };
+
+    using list_type = ::std::list<entry>;
+    using index_type = ::std::unordered_map<Key, typename list_type::iterator, Hash, KeyEqual>;
+
+    struct shard {
+        ::std::mutex mutex;
+        list_type entries;  // Most recently used first
+        index_type index;
+        ::std::size_t charge = 0;
+        ::std::size_t budget = 0;
+        ::std::atomic<::std::uint64_t> hits{0};
+        ::std::atomic<::std::uint64_t> misses{0};
+        ::std::atomic<::std::uint64_t> insertions{0};
+        ::std::atomic<::std::uint64_t> evictions{0};
+        // Keep shards on separate cache lines
+        char padding[64];
+    };
+
+    ::std::unique_ptr<shard[]> shards;
+    ::std::size_t shard_count;
+    eviction_policy policy;
+    Hash hash;
+
+    shard& shard_for(::std::size_t key_hash) const noexcept {
+        // Mix the bits, since the shard index and the unordered_map bucket would otherwise both use the low bits
+        ::std::uint64_t mixed = static_cast<::std::uint64_t>(key_hash) * UINT64_C(0x9E3779B97F4A7C15);
+        return shards[static_cast<::std::size_t>(mixed >> 32) % shard_count];
+    }
+
+    static handle share(T* value) noexcept {
+        // The cache's own reference keeps value alive, so this cannot fail
+        ::ref_counted_shared_ptr::detail::access::incref(*value, ::std::nothrow);
+        return handle(value, adopt_ref);
+    }
+
+    // Called with s.mutex locked
+    void evict(shard& s, ::std::vector<T*>& released) {
+        auto it = s.entries.end();
+        while (s.charge > s.budget && it != s.entries.begin()) {
+            --it;
+            // The entry just inserted is always at the front and is not evicted
+            if (it == s.entries.begin()) break;
+            if (policy == eviction_policy::pinned_aware && ::ref_counted_shared_ptr::detail::access::use_count(*it->value) > 1) continue;
+
+            released.push_back(it->value);
+            s.charge -= it->charge;
+            s.index.erase(it->key);
+            it = s.entries.erase(it);
+            s.evictions.fetch_add(1, ::std::memory_order_relaxed);
+        }
+    }
+
+    static void release_all(const ::std::vector<T*>& released) noexcept {
+        for (T* value : released) ::ref_counted_shared_ptr::detail::access::decref(*value, ::std::nothrow);
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_LRU_CACHE_H_
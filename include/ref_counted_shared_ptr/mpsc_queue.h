@@ -0,0 +1,133 @@
+#ifndef REF_COUNTED_SHARED_PTR_MPSC_QUEUE_H_
+#define REF_COUNTED_SHARED_PTR_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+#include "ref_counted_shared_ptr/std.h"
+
+
+namespace ref_counted_shared_ptr {
+
+template<typename T>
+class mpsc_queue;
+
+// Base class of objects that can be in an mpsc_queue. An object can only be in one queue, once, at a time.
+class mpsc_queue_hook {
+protected:
+    mpsc_queue_hook() noexcept : mpsc_next(nullptr) {}
+    mpsc_queue_hook(const mpsc_queue_hook&) noexcept : mpsc_next(nullptr) {}
+
+    mpsc_queue_hook& operator=(const mpsc_queue_hook&) noexcept {
+        return *this;
+    }
+
+    ~mpsc_queue_hook() = default;
+
+private:
+    ::std::atomic<mpsc_queue_hook*> mpsc_next;
+
+    template<typename T>
+    friend class mpsc_queue;
+};
+
+// Intrusive multiple producer, single consumer queue (Dmitry Vyukov's) of `T`s deriving from
+// std::ref_counted_shared_ptr<T> and mpsc_queue_hook. `push` takes over one reference and `pop` gives it back, so neither
+// allocates or modifies the reference count. `push` is wait free; `pop` is lock free, but can return null while a
+// `push` that started before it is only half done.
+template<typename T>
+class mpsc_queue {
+public:
+    using value_type = T;
+
+    mpsc_queue() noexcept : head(&stub), tail(&stub) {}
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    // `decref()`s the objects still in the queue
+    ~mpsc_queue() {
+        while (pop()) {}
+    }
+
+    // Takes over the reference owned by `p` (which must not be null)
+    void push(ref_counted_ptr<T>&& p) noexcept {
+        push(p.release(), adopt_ref);
+    }
+
+    // Takes over the reference owned by `p` (which must not be null) without modifying the reference count
+    void push(::std::shared_ptr<T>&& p) {
+        push(::ref_counted_shared_ptr::std::release_to_manual(::std::move(p)), adopt_ref);
+    }
+
+    // Takes over a reference already owned by the caller
+    void push(T* p, adopt_ref_t) noexcept {
+        push_hook(p);
+    }
+
+    // Consumer only. Returns the oldest object with the reference given to `push`, or null if the queue is empty.
+    ref_counted_ptr<T> pop() noexcept {
+        mpsc_queue_hook* first = tail;
+        mpsc_queue_hook* next = first->mpsc_next.load(::std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) return ref_counted_ptr<T>();
+            tail = next;
+            first = next;
+            next = next->mpsc_next.load(::std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return take(first);
+        }
+        // first is the last object. Unless a push has started after it, put the stub behind it so it can be removed.
+        if (first != head.load(::std::memory_order_acquire)) return ref_counted_ptr<T>();
+        push_hook(&stub);
+        next = first->mpsc_next.load(::std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return take(first);
+        }
+        return ref_counted_ptr<T>();
+    }
+
+    // Consumer only. Same as `pop()`, but returns a shared_ptr (taking over the reference, without modifying the
+    // reference count if the shared_ptr accessors of `T` are defined)
+    ::std::shared_ptr<T> pop_shared() {
+        ref_counted_ptr<T> p = pop();
+        if (!p) return nullptr;
+        ::std::shared_ptr<T> result = ::ref_counted_shared_ptr::std::adopt_manual(p.get());
+        p.release();
+        return result;
+    }
+
+    // Consumer only. May return false while a `push` is in progress.
+    bool empty() const noexcept {
+        return tail == &stub && !stub.mpsc_next.load(::std::memory_order_acquire);
+    }
+
+private:
+    // Written by producers
+    ::std::atomic<mpsc_queue_hook*> head;
+    // Keep producers and the consumer on separate cache lines
+    char padding[64];
+    // Only used by the consumer
+    mpsc_queue_hook* tail;
+    struct stub_hook : mpsc_queue_hook {} stub;
+
+    void push_hook(mpsc_queue_hook* node) noexcept {
+        node->mpsc_next.store(nullptr, ::std::memory_order_relaxed);
+        mpsc_queue_hook* previous = head.exchange(node, ::std::memory_order_acq_rel);
+        previous->mpsc_next.store(node, ::std::memory_order_release);
+    }
+
+    static ref_counted_ptr<T> take(mpsc_queue_hook* node) noexcept {
+        return ref_counted_ptr<T>(static_cast<T*>(node), adopt_ref);
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_MPSC_QUEUE_H_
@@ -0,0 +1,170 @@
+#ifndef REF_COUNTED_SHARED_PTR_PYTHON_H_
+#define REF_COUNTED_SHARED_PTR_PYTHON_H_
+
+// Python.h has to be included before any standard headers
+#include <Python.h>
+
+#include <new>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+
+namespace ref_counted_shared_ptr {
+
+template<typename T>
+class python_type;
+
+// Base class of `T`s given to Python with python_type<T>. Remembers the object's Python wrapper, so that giving the
+// object to Python again returns the same wrapper. Only accessed with the GIL held.
+class python_wrapper_cache {
+protected:
+    python_wrapper_cache() noexcept : python_wrapper(nullptr) {}
+    python_wrapper_cache(const python_wrapper_cache&) noexcept : python_wrapper(nullptr) {}
+
+    python_wrapper_cache& operator=(const python_wrapper_cache&) noexcept {
+        return *this;
+    }
+
+    ~python_wrapper_cache() = default;
+
+private:
+    // Borrowed. Cleared when the wrapper is deallocated, which the wrapper's reference keeps from happening before
+    // the object is destroyed.
+    mutable PyObject* python_wrapper;
+
+    template<typename T>
+    friend class python_type;
+};
+
+namespace detail {
+
+template<typename T>
+struct python_wrapper_object {
+    PyObject_HEAD
+    // Owns one `incref()` reference. Null if the wrapper was not made by python_type<T>::wrap.
+    T* object;
+};
+
+}
+
+// A Python type wrapping `T`s deriving from ref_counted_shared_ptr<T> and python_wrapper_cache. Each object has at
+// most one wrapper, which owns one `incref()` reference to it, so giving an object that Python already has back to
+// Python only increments the wrapper's `ob_refcnt`. The two counts stay separate: Python's references are counted by
+// `ob_refcnt`, and all of them together hold one C++ reference. All functions must be called with the GIL held.
+template<typename T>
+class python_type {
+public:
+    using wrapper_type = ::ref_counted_shared_ptr::detail::python_wrapper_object<T>;
+
+    // Creates the type (e.g. in the module's init function). `name` ("module.Name") and `methods` (whose `self`
+    // arguments are wrappers) must stay valid while the type exists. Returns a new reference, or null with a Python
+    // exception set.
+    static PyTypeObject* create(const char* name, PyMethodDef* methods = nullptr, const char* doc = nullptr) noexcept {
+        PyType_Slot slots[4];
+        int slot_count = 0;
+        slots[slot_count++] = { Py_tp_dealloc, reinterpret_cast<void*>(&dealloc) };
+        if (methods) slots[slot_count++] = { Py_tp_methods, methods };
+        if (doc) slots[slot_count++] = { Py_tp_doc, const_cast<char*>(doc) };
+        slots[slot_count] = { 0, nullptr };
+
+        unsigned int flags = Py_TPFLAGS_DEFAULT;
+#ifdef Py_TPFLAGS_DISALLOW_INSTANTIATION
+        flags |= Py_TPFLAGS_DISALLOW_INSTANTIATION;
+#endif
+        PyType_Spec spec = { name, static_cast<int>(sizeof(wrapper_type)), 0, flags, slots };
+        PyObject* type = PyType_FromSpec(&spec);
+        if (!type) return nullptr;
+
+        Py_XDECREF(reinterpret_cast<PyObject*>(type_object()));
+        Py_INCREF(type);
+        type_object() = reinterpret_cast<PyTypeObject*>(type);
+        return reinterpret_cast<PyTypeObject*>(type);
+    }
+
+    // Borrowed reference to the type made by `create()`
+    static PyTypeObject* type() noexcept {
+        return type_object();
+    }
+
+    // New reference to the wrapper of `p` (None if `p` is null). If `p` has no wrapper, makes one and `incref()`s `p`.
+    // Returns null with a Python exception set if that fails.
+    static PyObject* wrap(T* p) noexcept {
+        if (!p) Py_RETURN_NONE;
+        PyObject*& cached = cache_of(*p);
+        if (cached) {
+            Py_INCREF(cached);
+            return cached;
+        }
+        wrapper_type* wrapper = PyObject_New(wrapper_type, type_object());
+        if (!wrapper) return nullptr;
+        if (::ref_counted_shared_ptr::detail::access::incref(*p, ::std::nothrow) == 0) {
+            wrapper->object = nullptr;
+            Py_DECREF(reinterpret_cast<PyObject*>(wrapper));
+            PyErr_SetString(PyExc_ReferenceError, "object is not owned by a shared_ptr");
+            return nullptr;
+        }
+        wrapper->object = p;
+        cached = reinterpret_cast<PyObject*>(wrapper);
+        return cached;
+    }
+
+    // Same as `wrap(p.get())`, but takes over the reference owned by `p` if a new wrapper is made
+    static PyObject* wrap(ref_counted_ptr<T>&& p) noexcept {
+        if (!p) Py_RETURN_NONE;
+        PyObject*& cached = cache_of(*p);
+        if (cached) {
+            Py_INCREF(cached);
+            return cached;
+        }
+        wrapper_type* wrapper = PyObject_New(wrapper_type, type_object());
+        if (!wrapper) return nullptr;
+        wrapper->object = p.release();
+        cached = reinterpret_cast<PyObject*>(wrapper);
+        return cached;
+    }
+
+    static bool check(PyObject* object) noexcept {
+        return object && Py_TYPE(object) == type_object() && reinterpret_cast<wrapper_type*>(object)->object;
+    }
+
+    // The object wrapped by `object` (borrowed, valid while `object` is), or null with a TypeError set
+    static T* get(PyObject* object) noexcept {
+        if (!check(object)) {
+            PyErr_Format(PyExc_TypeError, "expected %s", type_object() ? type_object()->tp_name : "a wrapped object");
+            return nullptr;
+        }
+        return reinterpret_cast<wrapper_type*>(object)->object;
+    }
+
+    // A reference to the object wrapped by `object` for C++ to keep, or null with a TypeError set
+    static ref_counted_ptr<T> ref(PyObject* object) noexcept {
+        T* p = get(object);
+        if (p) ::ref_counted_shared_ptr::detail::access::incref(*p, ::std::nothrow);
+        return ref_counted_ptr<T>(p, adopt_ref);
+    }
+
+private:
+    static PyTypeObject*& type_object() noexcept {
+        static PyTypeObject* type = nullptr;
+        return type;
+    }
+
+    static PyObject*& cache_of(const T& p) noexcept {
+        return static_cast<const python_wrapper_cache&>(p).python_wrapper;
+    }
+
+    static void dealloc(PyObject* self) noexcept {
+        T* p = reinterpret_cast<wrapper_type*>(self)->object;
+        PyTypeObject* type = Py_TYPE(self);
+        if (p) cache_of(*p) = nullptr;
+        PyObject_Free(self);
+        Py_DECREF(reinterpret_cast<PyObject*>(type));
+        // Can destroy *p, which can run arbitrary code, so only after the wrapper is gone
+        if (p) ::ref_counted_shared_ptr::detail::access::decref(*p, ::std::nothrow);
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_PYTHON_H_
@@ -0,0 +1,103 @@
+#ifndef REF_COUNTED_SHARED_PTR_RECYCLING_H_
+#define REF_COUNTED_SHARED_PTR_RECYCLING_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/std.h"
+
+
+// Maximum number of recycled objects of each type kept by each thread
+#ifndef REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY
+#define REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY 64
+#endif
+
+
+namespace ref_counted_shared_ptr {
+namespace detail {
+
+// Per thread freelist of `T`s whose reference count reached 0. Each one keeps its control block alive through the
+// weak reference held by its enable_shared_from_this base.
+template<typename T>
+class recycle_bin {
+public:
+    static constexpr ::std::size_t capacity = REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY;
+
+    recycle_bin() noexcept : size(0) {}
+
+    recycle_bin(const recycle_bin&) = delete;
+    recycle_bin& operator=(const recycle_bin&) = delete;
+
+    ~recycle_bin() {
+        // Destroying objects can release more `T`s, which should now be deleted instead of recycled
+        destroyed() = true;
+        while (size != 0) delete objects[--size];
+    }
+
+    bool push(T* p) noexcept {
+        if (size == capacity) return false;
+        objects[size++] = p;
+        return true;
+    }
+
+    T* pop() noexcept {
+        return size == 0 ? nullptr : objects[--size];
+    }
+
+    // Null once this thread's recycle_bin<T> has been destroyed
+    static recycle_bin* current() noexcept {
+        if (destroyed()) return nullptr;
+        static thread_local recycle_bin bin;
+        return &bin;
+    }
+
+private:
+    T* objects[capacity];
+    ::std::size_t size;
+
+    static bool& destroyed() noexcept {
+        static thread_local bool value = false;
+        return value;
+    }
+};
+
+// Called by the control block when the reference count reaches 0. Instead of deleting the object, resets it with
+// `p->recycle()` and keeps it (and its control block) in this thread's recycle_bin<T> if there is room.
+template<typename T>
+struct recycling_deleter {
+    void operator()(T* p) const noexcept {
+        recycle_bin<T>* bin = recycle_bin<T>::current();
+        if (bin) {
+            ::ref_counted_shared_ptr::detail::access::recycle(*p);
+            if (bin->push(p)) return;
+        }
+        delete p;
+    }
+};
+
+}
+
+// Returns a `T` (deriving from std::ref_counted_shared_ptr<T>, with a `void recycle() noexcept` member function)
+// from this thread's freelist, or a new value initialized `T` if it is empty.
+// When its reference count reaches 0, the object is not destroyed. `recycle()` is called to reset it, and it is added
+// to the freelist of the thread that released the last reference, along with its control block. Objects that do not
+// fit in the freelist (REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY per type per thread) are deleted.
+// Recycled objects must not be observed through weak_ptr: the control block is reused without a new generation, so a
+// weak_ptr taken during one use can lock the object during a later, unrelated use.
+// Only supports std::shared_ptr, whose control block is revived directly.
+template<typename T>
+::std::shared_ptr<T> make_recycled() {
+    ::ref_counted_shared_ptr::detail::recycle_bin<T>* bin = ::ref_counted_shared_ptr::detail::recycle_bin<T>::current();
+    T* p = bin ? bin->pop() : nullptr;
+    if (!p) return ::std::shared_ptr<T>(new T(), ::ref_counted_shared_ptr::detail::recycling_deleter<T>());
+
+    // The revived reference is in the control block, even if `T` has an external count
+    using implementation = ::ref_counted_shared_ptr::detail::common_implementation<::ref_counted_shared_ptr::detail::std::implementation_information>;
+    implementation::template revive<T>(*p);
+    return implementation::adopt_manual(*p, p);
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_RECYCLING_H_
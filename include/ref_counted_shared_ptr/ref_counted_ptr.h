@@ -0,0 +1,179 @@
+#ifndef REF_COUNTED_SHARED_PTR_REF_COUNTED_PTR_H_
+#define REF_COUNTED_SHARED_PTR_REF_COUNTED_PTR_H_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+
+
+namespace ref_counted_shared_ptr {
+
+struct adopt_ref_t {
+    explicit adopt_ref_t() = default;
+};
+
+// Tag to construct a ref_counted_ptr<T> from a pointer that already has a reference from `incref()` to give it
+constexpr adopt_ref_t adopt_ref{};
+
+// Intrusive smart pointer (8 bytes) owning one `incref()` reference on a `T` deriving from ref_counted_shared_ptr<T>
+template<typename T>
+class ref_counted_ptr {
+public:
+    using element_type = T;
+
+    constexpr ref_counted_ptr() noexcept : ptr(nullptr) {}
+    constexpr ref_counted_ptr(::std::nullptr_t) noexcept : ptr(nullptr) {}
+
+    // Calls p->incref() (which may throw bad_weak_ptr) if p is not null
+    explicit ref_counted_ptr(T* p) : ptr(p) {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::incref(*ptr);
+    }
+
+    ref_counted_ptr(T* p, adopt_ref_t) noexcept : ptr(p) {}
+
+    ref_counted_ptr(const ref_counted_ptr& other) noexcept : ptr(other.ptr) {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::incref(*ptr, ::std::nothrow);
+    }
+
+    ref_counted_ptr(ref_counted_ptr&& other) noexcept : ptr(other.ptr) {
+        other.ptr = nullptr;
+    }
+
+    template<typename U, typename = typename ::std::enable_if<::std::is_convertible<U*, T*>::value>::type>
+    ref_counted_ptr(const ref_counted_ptr<U>& other) noexcept : ptr(other.get()) {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::incref(*ptr, ::std::nothrow);
+    }
+
+    template<typename U, typename = typename ::std::enable_if<::std::is_convertible<U*, T*>::value>::type>
+    ref_counted_ptr(ref_counted_ptr<U>&& other) noexcept : ptr(other.release()) {}
+
+    ~ref_counted_ptr() {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::decref(*ptr, ::std::nothrow);
+    }
+
+    ref_counted_ptr& operator=(const ref_counted_ptr& other) noexcept {
+        ref_counted_ptr(other).swap(*this);
+        return *this;
+    }
+
+    ref_counted_ptr& operator=(ref_counted_ptr&& other) noexcept {
+        ref_counted_ptr(::std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ref_counted_ptr& operator=(::std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    void reset() noexcept {
+        ref_counted_ptr().swap(*this);
+    }
+
+    void reset(T* p) {
+        ref_counted_ptr(p).swap(*this);
+    }
+
+    void reset(T* p, adopt_ref_t) noexcept {
+        ref_counted_ptr(p, adopt_ref).swap(*this);
+    }
+
+    // Gives up ownership of the reference without calling decref()
+    T* release() noexcept {
+        T* p = ptr;
+        ptr = nullptr;
+        return p;
+    }
+
+    void swap(ref_counted_ptr& other) noexcept {
+        T* p = ptr;
+        ptr = other.ptr;
+        other.ptr = p;
+    }
+
+    T* get() const noexcept {
+        return ptr;
+    }
+
+    T& operator*() const noexcept {
+        return *ptr;
+    }
+
+    T* operator->() const noexcept {
+        return ptr;
+    }
+
+    explicit operator bool() const noexcept {
+        return ptr != nullptr;
+    }
+
+    // A shared_ptr to the same object (empty if this is null).
+    // A template so that ref_counted_ptr<T> can be a member of an incomplete T.
+    template<typename U = T>
+    auto shared() const -> decltype(::std::declval<U&>().shared_from_this()) {
+        if (!ptr) return {};
+        return ptr->shared_from_this();
+    }
+
+private:
+    T* ptr;
+};
+
+template<typename T>
+void swap(ref_counted_ptr<T>& a, ref_counted_ptr<T>& b) noexcept {
+    a.swap(b);
+}
+
+template<typename T, typename U>
+bool operator==(const ref_counted_ptr<T>& a, const ref_counted_ptr<U>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template<typename T, typename U>
+bool operator!=(const ref_counted_ptr<T>& a, const ref_counted_ptr<U>& b) noexcept {
+    return a.get() != b.get();
+}
+
+template<typename T, typename U>
+bool operator<(const ref_counted_ptr<T>& a, const ref_counted_ptr<U>& b) noexcept {
+    return ::std::less<typename ::std::common_type<T*, U*>::type>()(a.get(), b.get());
+}
+
+template<typename T>
+bool operator==(const ref_counted_ptr<T>& a, ::std::nullptr_t) noexcept {
+    return !a;
+}
+
+template<typename T>
+bool operator==(::std::nullptr_t, const ref_counted_ptr<T>& a) noexcept {
+    return !a;
+}
+
+template<typename T>
+bool operator!=(const ref_counted_ptr<T>& a, ::std::nullptr_t) noexcept {
+    return static_cast<bool>(a);
+}
+
+template<typename T>
+bool operator!=(::std::nullptr_t, const ref_counted_ptr<T>& a) noexcept {
+    return static_cast<bool>(a);
+}
+
+}
+
+namespace std {
+
+template<typename T>
+struct hash<::ref_counted_shared_ptr::ref_counted_ptr<T>> {
+    ::std::size_t operator()(const ::ref_counted_shared_ptr::ref_counted_ptr<T>& p) const noexcept {
+        return ::std::hash<T*>()(p.get());
+    }
+};
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_REF_COUNTED_PTR_H_
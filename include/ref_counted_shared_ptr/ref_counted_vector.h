@@ -0,0 +1,250 @@
+#ifndef REF_COUNTED_SHARED_PTR_REF_COUNTED_VECTOR_H_
+#define REF_COUNTED_SHARED_PTR_REF_COUNTED_VECTOR_H_
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/impl/common.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+
+// How many elements ahead bulk decrefs prefetch reference counts (and twice as many ahead, the objects themselves)
+#ifndef REF_COUNTED_SHARED_PTR_VECTOR_PREFETCH_DISTANCE
+#define REF_COUNTED_SHARED_PTR_VECTOR_PREFETCH_DISTANCE 8
+#endif
+
+
+namespace ref_counted_shared_ptr {
+
+// A vector of (possibly null) `T*`, each non-null element owning one `incref()` reference.
+// Since the elements are raw pointers, reallocating never touches reference counts.
+// Element access returns borrowed `T*`s, valid as long as the element is not erased or replaced.
+template<typename T>
+class ref_counted_vector {
+    using storage_type = ::std::vector<T*>;
+
+public:
+    using value_type = T*;
+    using size_type = typename storage_type::size_type;
+    using difference_type = typename storage_type::difference_type;
+    using const_reference = T* const&;
+    using reference = const_reference;
+    using const_pointer = T* const*;
+    using pointer = const_pointer;
+    using const_iterator = typename storage_type::const_iterator;
+    using iterator = const_iterator;
+    using const_reverse_iterator = typename storage_type::const_reverse_iterator;
+    using reverse_iterator = const_reverse_iterator;
+
+    ref_counted_vector() noexcept = default;
+
+    ref_counted_vector(const ref_counted_vector& other) : elements(other.elements) {
+        incref_all(elements.data(), elements.data() + elements.size());
+    }
+
+    ref_counted_vector(ref_counted_vector&& other) noexcept : elements(::std::move(other.elements)) {
+        other.elements.clear();
+    }
+
+    template<typename InputIt>
+    ref_counted_vector(InputIt first, InputIt last) {
+        assign(first, last);
+    }
+
+    ref_counted_vector(::std::initializer_list<T*> list) {
+        assign(list.begin(), list.end());
+    }
+
+    ~ref_counted_vector() {
+        decref_all(elements.data(), elements.data() + elements.size());
+    }
+
+    ref_counted_vector& operator=(const ref_counted_vector& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+
+    ref_counted_vector& operator=(ref_counted_vector&& other) noexcept {
+        ref_counted_vector(::std::move(other)).swap(*this);
+        return *this;
+    }
+
+    // Replaces the contents with `incref()`ed copies of [first, last). If an `incref()` throws, *this is unchanged.
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        storage_type new_elements(first, last);
+        incref_all(new_elements.data(), new_elements.data() + new_elements.size());
+        elements.swap(new_elements);
+        decref_all(new_elements.data(), new_elements.data() + new_elements.size());
+    }
+
+    void assign(::std::initializer_list<T*> list) {
+        assign(list.begin(), list.end());
+    }
+
+    // Capacity
+    bool empty() const noexcept { return elements.empty(); }
+    size_type size() const noexcept { return elements.size(); }
+    size_type max_size() const noexcept { return elements.max_size(); }
+    size_type capacity() const noexcept { return elements.capacity(); }
+    void reserve(size_type new_capacity) { elements.reserve(new_capacity); }
+    void shrink_to_fit() { elements.shrink_to_fit(); }
+
+    // Element access (borrowed)
+    T* operator[](size_type i) const noexcept { return elements[i]; }
+    T* at(size_type i) const { return elements.at(i); }
+    T* front() const noexcept { return elements.front(); }
+    T* back() const noexcept { return elements.back(); }
+    const_pointer data() const noexcept { return elements.data(); }
+
+    // Element access (owning). `shared` requires the element to not be null.
+    ref_counted_ptr<T> ref(size_type i) const noexcept {
+        T* p = elements[i];
+        if (p) ::ref_counted_shared_ptr::detail::access::incref(*p, ::std::nothrow);
+        return ref_counted_ptr<T>(p, adopt_ref);
+    }
+
+    template<typename U = T>
+    auto shared(size_type i) const -> decltype(::std::declval<U&>().shared_from_this()) {
+        return elements[i]->shared_from_this();
+    }
+
+    // Iterators
+    const_iterator begin() const noexcept { return elements.begin(); }
+    const_iterator end() const noexcept { return elements.end(); }
+    const_iterator cbegin() const noexcept { return elements.cbegin(); }
+    const_iterator cend() const noexcept { return elements.cend(); }
+    const_reverse_iterator rbegin() const noexcept { return elements.rbegin(); }
+    const_reverse_iterator rend() const noexcept { return elements.rend(); }
+    const_reverse_iterator crbegin() const noexcept { return elements.crbegin(); }
+    const_reverse_iterator crend() const noexcept { return elements.crend(); }
+
+    // Modifiers
+    // `incref()`s p (which may throw bad_weak_ptr)
+    void push_back(T* p) {
+        elements.push_back(p);
+        if (p) {
+            try {
+                ::ref_counted_shared_ptr::detail::access::incref(*p);
+            } catch (...) {
+                elements.pop_back();
+                throw;
+            }
+        }
+    }
+
+    // Takes the reference owned by p
+    void push_back(ref_counted_ptr<T>&& p) {
+        elements.push_back(p.get());
+        p.release();
+    }
+
+    // Takes the reference owned by p
+    void push_back(T* p, adopt_ref_t) {
+        elements.push_back(p);
+    }
+
+    void pop_back() noexcept {
+        T* p = elements.back();
+        elements.pop_back();
+        if (p) ::ref_counted_shared_ptr::detail::access::decref(*p, ::std::nothrow);
+    }
+
+    // Removes the last element, giving its reference to the caller
+    ref_counted_ptr<T> take_back() noexcept {
+        T* p = elements.back();
+        elements.pop_back();
+        return ref_counted_ptr<T>(p, adopt_ref);
+    }
+
+    const_iterator insert(const_iterator pos, T* p) {
+        const_iterator result = elements.insert(pos, p);
+        if (p) {
+            try {
+                ::ref_counted_shared_ptr::detail::access::incref(*p);
+            } catch (...) {
+                elements.erase(result);
+                throw;
+            }
+        }
+        return result;
+    }
+
+    const_iterator insert(const_iterator pos, ref_counted_ptr<T>&& p) {
+        const_iterator result = elements.insert(pos, p.get());
+        p.release();
+        return result;
+    }
+
+    const_iterator erase(const_iterator pos) noexcept {
+        T* p = *pos;
+        const_iterator result = elements.erase(pos);
+        if (p) ::ref_counted_shared_ptr::detail::access::decref(*p, ::std::nothrow);
+        return result;
+    }
+
+    const_iterator erase(const_iterator first, const_iterator last) noexcept {
+        T* const* data = elements.data();
+        decref_all(data + (first - begin()), data + (last - begin()));
+        return elements.erase(first, last);
+    }
+
+    void clear() noexcept {
+        decref_all(elements.data(), elements.data() + elements.size());
+        elements.clear();
+    }
+
+    // Null elements added by growing are not `incref()`ed
+    void resize(size_type new_size) {
+        if (new_size < size()) {
+            erase(begin() + static_cast<difference_type>(new_size), end());
+        } else {
+            elements.resize(new_size, nullptr);
+        }
+    }
+
+    void swap(ref_counted_vector& other) noexcept {
+        elements.swap(other.elements);
+    }
+
+private:
+    storage_type elements;
+
+    // Exception safe: If an incref throws, all earlier increfs are undone
+    static void incref_all(T* const* first, T* const* last) {
+        for (T* const* it = first; it != last; ++it) {
+            if (!*it) continue;
+            try {
+                ::ref_counted_shared_ptr::detail::access::incref(**it);
+            } catch (...) {
+                decref_all(first, it);
+                throw;
+            }
+        }
+    }
+
+    static void decref_all(T* const* first, T* const* last) noexcept {
+        constexpr ::std::ptrdiff_t distance = REF_COUNTED_SHARED_PTR_VECTOR_PREFETCH_DISTANCE;
+        for (T* const* it = first; it != last; ++it) {
+            // Finding the control block needs the object, so fetch objects ahead of their control blocks
+            if (last - it > 2 * distance && it[2 * distance]) REF_COUNTED_SHARED_PTR_PREFETCH(it[2 * distance]);
+            if (last - it > distance && it[distance]) ::ref_counted_shared_ptr::detail::access::prefetch_count(*it[distance]);
+            if (*it) ::ref_counted_shared_ptr::detail::access::decref(**it, ::std::nothrow);
+        }
+    }
+};
+
+template<typename T>
+void swap(ref_counted_vector<T>& a, ref_counted_vector<T>& b) noexcept {
+    a.swap(b);
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_REF_COUNTED_VECTOR_H_
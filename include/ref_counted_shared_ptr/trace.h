@@ -0,0 +1,297 @@
+#ifndef REF_COUNTED_SHARED_PTR_TRACE_H_
+#define REF_COUNTED_SHARED_PTR_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <typeinfo>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#define REF_COUNTED_SHARED_PTR_TRACE_CRASH_HANDLER
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define REF_COUNTED_SHARED_PTR_TRACE_UNLIKELY(...) __builtin_expect(static_cast<bool>(__VA_ARGS__), 0)
+#define REF_COUNTED_SHARED_PTR_TRACE_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define REF_COUNTED_SHARED_PTR_TRACE_UNLIKELY(...) (__VA_ARGS__)
+#define REF_COUNTED_SHARED_PTR_TRACE_NOINLINE __declspec(noinline)
+#else
+#define REF_COUNTED_SHARED_PTR_TRACE_UNLIKELY(...) (__VA_ARGS__)
+#define REF_COUNTED_SHARED_PTR_TRACE_NOINLINE
+#endif
+
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+#define REF_COUNTED_SHARED_PTR_TRACE_TYPE_NAME(...) typeid(__VA_ARGS__).name()
+#else
+#define REF_COUNTED_SHARED_PTR_TRACE_TYPE_NAME(...) ""
+#endif
+
+// Number of records kept per thread. Must be a power of 2.
+#ifndef REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE
+#define REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE 8192
+#endif
+
+// Number of distinct traced types whose names are recorded
+#ifndef REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES
+#define REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES 1024
+#endif
+
+
+namespace ref_counted_shared_ptr {
+namespace trace {
+
+enum class operation_type : ::std::uint16_t {
+    incref = 0,
+    decref = 1,
+    zero_references = 2,
+    bad_weak_ptr = 3,
+    try_incref_failed = 4
+};
+
+// Fixed size binary record, written to dumps as is (in native byte order)
+struct record {
+    // Nanoseconds since an unspecified epoch (of std::chrono::steady_clock)
+    ::std::uint64_t timestamp;
+    // Address of the enable_shared_from_this base of the object
+    ::std::uint64_t object;
+    ::std::uint32_t type_id;
+    // An operation_type
+    ::std::uint16_t operation;
+    // Small sequential id for the thread that made the record
+    ::std::uint16_t thread_id;
+    // Reference count after the operation
+    ::std::int64_t count;
+};
+
+static_assert(sizeof(record) == 32, "ref_counted_shared_ptr::trace::record must be 32 bytes");
+static_assert((REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE & (REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE - 1)) == 0, "REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE must be a power of 2");
+
+// Dump file layout:
+//     char magic[8] = dump_magic
+//     uint32_t version = dump_version
+//     uint32_t record_size = sizeof(record)
+//     uint32_t type_count
+//     type_count times: uint32_t type_id, uint32_t name_length, char name[name_length]
+//     uint64_t record_count
+//     record records[record_count]  (in no particular order)
+constexpr char dump_magic[8] = { 'R', 'C', 'S', 'P', 'T', 'R', 'C', '\0' };
+constexpr ::std::uint32_t dump_version = 1;
+
+namespace detail {
+
+struct thread_buffer {
+    record records[REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE];
+    // Total number of records ever written. Only modified by the owning thread.
+    ::std::atomic<::std::uint64_t> head;
+    ::std::uint16_t thread_id;
+    thread_buffer* next;
+};
+
+template<typename = void>
+struct globals {
+    static ::std::atomic<bool> enabled;
+    // Buffers are never freed, so records from threads that have exited can still be dumped
+    static ::std::atomic<thread_buffer*> buffers;
+    static ::std::atomic<::std::uint32_t> thread_count;
+    static ::std::atomic<::std::uint32_t> type_count;
+    static ::std::atomic<const char*> type_names[REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES];
+    static char crash_dump_path[4096];
+};
+
+template<typename D> ::std::atomic<bool> globals<D>::enabled{false};
+template<typename D> ::std::atomic<thread_buffer*> globals<D>::buffers{nullptr};
+template<typename D> ::std::atomic<::std::uint32_t> globals<D>::thread_count{0};
+template<typename D> ::std::atomic<::std::uint32_t> globals<D>::type_count{0};
+template<typename D> ::std::atomic<const char*> globals<D>::type_names[REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES];
+template<typename D> char globals<D>::crash_dump_path[4096];
+
+inline ::std::uint32_t register_type(const char* name) noexcept {
+    ::std::uint32_t id = globals<>::type_count.fetch_add(1, ::std::memory_order_relaxed);
+    if (id < REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES) globals<>::type_names[id].store(name, ::std::memory_order_release);
+    return id;
+}
+
+template<typename T>
+::std::uint32_t type_id() noexcept {
+    static const ::std::uint32_t id = register_type(REF_COUNTED_SHARED_PTR_TRACE_TYPE_NAME(T));
+    return id;
+}
+
+inline thread_buffer* new_thread_buffer() noexcept {
+    thread_buffer* buffer = new (::std::nothrow) thread_buffer;
+    if (!buffer) return nullptr;
+    buffer->head.store(0, ::std::memory_order_relaxed);
+    buffer->thread_id = static_cast<::std::uint16_t>(globals<>::thread_count.fetch_add(1, ::std::memory_order_relaxed));
+    buffer->next = globals<>::buffers.load(::std::memory_order_relaxed);
+    while (!globals<>::buffers.compare_exchange_weak(buffer->next, buffer, ::std::memory_order_release, ::std::memory_order_relaxed)) {}
+    return buffer;
+}
+
+inline thread_buffer* current_thread_buffer() noexcept {
+    static thread_local thread_buffer* buffer = nullptr;
+    if (!buffer) buffer = new_thread_buffer();
+    return buffer;
+}
+
+template<typename T>
+REF_COUNTED_SHARED_PTR_TRACE_NOINLINE void write_event(operation_type operation, const void* object, long count) noexcept {
+    thread_buffer* buffer = current_thread_buffer();
+    if (!buffer) return;
+
+    ::std::uint64_t head = buffer->head.load(::std::memory_order_relaxed);
+    record& r = buffer->records[head & (REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE - 1)];
+    r.timestamp = static_cast<::std::uint64_t>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(::std::chrono::steady_clock::now().time_since_epoch()).count());
+    r.object = static_cast<::std::uint64_t>(reinterpret_cast<::std::uintptr_t>(object));
+    r.type_id = type_id<T>();
+    r.operation = static_cast<::std::uint16_t>(operation);
+    r.thread_id = buffer->thread_id;
+    r.count = count;
+    buffer->head.store(head + 1, ::std::memory_order_release);
+}
+
+// Called by common_implementation when REF_COUNTED_SHARED_PTR_TRACE is defined
+template<typename T>
+inline void record_event(operation_type operation, const void* object, long count) noexcept {
+    if (REF_COUNTED_SHARED_PTR_TRACE_UNLIKELY(globals<>::enabled.load(::std::memory_order_relaxed))) {
+        write_event<T>(operation, object, count);
+    }
+}
+
+// Writer: bool(const void* data, std::size_t size). Only uses async-signal-safe operations other than what Writer does.
+template<typename Writer>
+bool dump_with(Writer& write) noexcept {
+    ::std::uint32_t type_count = globals<>::type_count.load(::std::memory_order_relaxed);
+    if (type_count > REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES) type_count = REF_COUNTED_SHARED_PTR_TRACE_MAX_TYPES;
+    ::std::uint32_t header[3] = { dump_version, static_cast<::std::uint32_t>(sizeof(record)), type_count };
+    if (!write(dump_magic, sizeof(dump_magic)) || !write(header, sizeof(header))) return false;
+
+    for (::std::uint32_t id = 0; id < type_count; ++id) {
+        const char* name = globals<>::type_names[id].load(::std::memory_order_acquire);
+        if (!name) name = "";
+        ::std::uint32_t entry[2] = { id, static_cast<::std::uint32_t>(::std::strlen(name)) };
+        if (!write(entry, sizeof(entry)) || !write(name, entry[1])) return false;
+    }
+
+    thread_buffer* first = globals<>::buffers.load(::std::memory_order_acquire);
+    ::std::uint64_t record_count = 0;
+    for (thread_buffer* buffer = first; buffer; buffer = buffer->next) {
+        ::std::uint64_t head = buffer->head.load(::std::memory_order_acquire);
+        record_count += head < REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE ? head : REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE;
+    }
+    if (!write(&record_count, sizeof(record_count))) return false;
+
+    // Records being written concurrently may be torn or overwritten, so this is only exact when other threads are not tracing.
+    // Stops at the counted number of records so the header stays consistent.
+    for (thread_buffer* buffer = first; buffer && record_count; buffer = buffer->next) {
+        ::std::uint64_t head = buffer->head.load(::std::memory_order_acquire);
+        ::std::uint64_t count = head < REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE ? head : REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE;
+        if (count > record_count) count = record_count;
+        for (::std::uint64_t i = head - count; i != head; ++i) {
+            if (!write(&buffer->records[i & (REF_COUNTED_SHARED_PTR_TRACE_BUFFER_SIZE - 1)], sizeof(record))) return false;
+        }
+        record_count -= count;
+    }
+    // Pad with empty records if the counts shrank (cannot happen unless head wraps around mid-dump)
+    static const record empty = {};
+    for (; record_count; --record_count) {
+        if (!write(&empty, sizeof(record))) return false;
+    }
+    return true;
+}
+
+#ifdef REF_COUNTED_SHARED_PTR_TRACE_CRASH_HANDLER
+struct fd_writer {
+    int fd;
+
+    bool operator()(const void* data, ::std::size_t size) noexcept {
+        const char* p = static_cast<const char*>(data);
+        while (size) {
+            ::ssize_t written = ::write(fd, p, size);
+            if (written <= 0) return false;
+            p += written;
+            size -= static_cast<::std::size_t>(written);
+        }
+        return true;
+    }
+};
+
+inline void crash_handler(int signal_number) {
+    int fd = ::open(globals<>::crash_dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        fd_writer writer{fd};
+        dump_with(writer);
+        ::close(fd);
+    }
+    // Handler was installed with SA_RESETHAND, so this runs the default action
+    ::raise(signal_number);
+}
+#endif
+
+}
+
+// Start or stop recording. Only has an effect if REF_COUNTED_SHARED_PTR_TRACE was defined before including any
+// ref_counted_shared_ptr header, otherwise nothing is ever recorded. Recording starts disabled.
+inline void enable() noexcept {
+    detail::globals<>::enabled.store(true, ::std::memory_order_relaxed);
+}
+
+inline void disable() noexcept {
+    detail::globals<>::enabled.store(false, ::std::memory_order_relaxed);
+}
+
+inline bool is_enabled() noexcept {
+    return detail::globals<>::enabled.load(::std::memory_order_relaxed);
+}
+
+// Write the contents of every thread's ring buffer to `file`. Returns false if a write failed.
+inline bool dump(::std::FILE* file) noexcept {
+    auto writer = [file](const void* data, ::std::size_t size) noexcept {
+        return ::std::fwrite(data, 1, size, file) == size;
+    };
+    return detail::dump_with(writer) && ::std::fflush(file) == 0;
+}
+
+inline bool dump(const char* path) noexcept {
+    ::std::FILE* file = ::std::fopen(path, "wb");
+    if (!file) return false;
+    bool result = dump(file);
+    return ::std::fclose(file) == 0 && result;
+}
+
+// Dump to `path` when the process receives SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT, then continue with the default action.
+// Returns false if `path` is too long or handlers could not be installed (including on platforms other than POSIX).
+inline bool install_crash_handler(const char* path) noexcept {
+#ifdef REF_COUNTED_SHARED_PTR_TRACE_CRASH_HANDLER
+    ::std::size_t length = ::std::strlen(path);
+    if (length >= sizeof(detail::globals<>::crash_dump_path)) return false;
+    ::std::memcpy(detail::globals<>::crash_dump_path, path, length + 1);
+
+    struct ::sigaction action;
+    ::std::memset(&action, 0, sizeof(action));
+    action.sa_handler = &detail::crash_handler;
+    action.sa_flags = SA_RESETHAND;
+    ::sigemptyset(&action.sa_mask);
+
+    const int signal_numbers[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    bool result = true;
+    for (int signal_number : signal_numbers) {
+        result = ::sigaction(signal_number, &action, nullptr) == 0 && result;
+    }
+    return result;
+#else
+    static_cast<void>(path);
+    return false;
+#endif
+}
+
+}
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_TRACE_H_
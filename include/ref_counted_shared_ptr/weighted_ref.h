@@ -0,0 +1,168 @@
+#ifndef REF_COUNTED_SHARED_PTR_WEIGHTED_REF_H_
+#define REF_COUNTED_SHARED_PTR_WEIGHTED_REF_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "ref_counted_shared_ptr/detail/access.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+
+// Number of references a weighted_ref takes at a time (when created, and when it has to split a weight of 1).
+// Kept small so that the total weight stays far below the immortal threshold.
+#ifndef REF_COUNTED_SHARED_PTR_WEIGHTED_REF_WEIGHT
+#define REF_COUNTED_SHARED_PTR_WEIGHTED_REF_WEIGHT 64
+#endif
+
+
+namespace ref_counted_shared_ptr {
+
+// Move only handle owning `weight()` references on a `T` deriving from ref_counted_shared_ptr<T>.
+// `split()` makes another handle by giving it half of this handle's weight, without modifying the reference count,
+// so it can be handed to another thread for free. The reference count is only modified when a handle is destroyed
+// (`decref(weight())`), and when a handle with a weight of 1 is split (`incref(REF_COUNTED_SHARED_PTR_WEIGHTED_REF_WEIGHT)`).
+// While weighted_refs exist, `use_count()` counts their weight instead of the number of handles.
+template<typename T>
+class weighted_ref {
+public:
+    using element_type = T;
+
+    static constexpr long default_weight = REF_COUNTED_SHARED_PTR_WEIGHTED_REF_WEIGHT;
+
+    constexpr weighted_ref() noexcept : ptr(nullptr), ref_weight(0) {}
+    constexpr weighted_ref(::std::nullptr_t) noexcept : ptr(nullptr), ref_weight(0) {}
+
+    // Calls p->incref(default_weight) (which may throw bad_weak_ptr) if p is not null
+    explicit weighted_ref(T* p) : ptr(p), ref_weight(p ? default_weight : 0) {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::incref(*ptr, default_weight);
+    }
+
+    // Takes over `weight` (> 0) references already owned by the caller
+    weighted_ref(T* p, long weight, adopt_ref_t) noexcept : ptr(p), ref_weight(p ? weight : 0) {}
+
+    // Takes over the reference owned by `p`, with a weight of 1
+    explicit weighted_ref(ref_counted_ptr<T>&& p) noexcept : ptr(p.release()), ref_weight(ptr ? 1 : 0) {}
+
+    weighted_ref(weighted_ref&& other) noexcept : ptr(other.ptr), ref_weight(other.ref_weight) {
+        other.ptr = nullptr;
+        other.ref_weight = 0;
+    }
+
+    weighted_ref(const weighted_ref&) = delete;
+    weighted_ref& operator=(const weighted_ref&) = delete;
+
+    ~weighted_ref() {
+        if (ptr) ::ref_counted_shared_ptr::detail::access::decref(*ptr, ref_weight, ::std::nothrow);
+    }
+
+    weighted_ref& operator=(weighted_ref&& other) noexcept {
+        weighted_ref(::std::move(other)).swap(*this);
+        return *this;
+    }
+
+    weighted_ref& operator=(::std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    // A handle to the same object with half of this handle's weight (null if this is null)
+    weighted_ref split() noexcept {
+        if (!ptr) return weighted_ref();
+        if (ref_weight == 1) {
+            // This handle's reference keeps *ptr alive, so this cannot fail
+            ::ref_counted_shared_ptr::detail::access::incref(*ptr, default_weight, ::std::nothrow);
+            ref_weight += default_weight;
+        }
+        long given = ref_weight / 2;
+        ref_weight -= given;
+        return weighted_ref(ptr, given, adopt_ref);
+    }
+
+    // Takes over the weight of `other` if it is null or refers to the same object (or this is null), without modifying
+    // the reference count. Returns false and leaves both handles unchanged if they refer to different objects.
+    bool merge(weighted_ref&& other) noexcept {
+        if (!other.ptr) return true;
+        if (!ptr) {
+            swap(other);
+            return true;
+        }
+        if (ptr != other.ptr) return false;
+        ref_weight += other.ref_weight;
+        other.ptr = nullptr;
+        other.ref_weight = 0;
+        return true;
+    }
+
+    // An ordinary reference to the same object (null if this is null). Only modifies the reference count if this
+    // handle's weight is 1.
+    ref_counted_ptr<T> ref() noexcept {
+        if (!ptr) return ref_counted_ptr<T>();
+        if (ref_weight == 1) {
+            ::ref_counted_shared_ptr::detail::access::incref(*ptr, ::std::nothrow);
+        } else {
+            --ref_weight;
+        }
+        return ref_counted_ptr<T>(ptr, adopt_ref);
+    }
+
+    // Gives up this handle, returning its object with one reference for the caller.
+    // Calls `decref(weight() - 1)` if the weight is more than 1.
+    ref_counted_ptr<T> release() noexcept {
+        T* p = ptr;
+        if (p && ref_weight != 1) ::ref_counted_shared_ptr::detail::access::decref(*p, ref_weight - 1, ::std::nothrow);
+        ptr = nullptr;
+        ref_weight = 0;
+        return ref_counted_ptr<T>(p, adopt_ref);
+    }
+
+    void reset() noexcept {
+        weighted_ref().swap(*this);
+    }
+
+    void swap(weighted_ref& other) noexcept {
+        T* p = ptr;
+        ptr = other.ptr;
+        other.ptr = p;
+        long w = ref_weight;
+        ref_weight = other.ref_weight;
+        other.ref_weight = w;
+    }
+
+    T* get() const noexcept {
+        return ptr;
+    }
+
+    T& operator*() const noexcept {
+        return *ptr;
+    }
+
+    T* operator->() const noexcept {
+        return ptr;
+    }
+
+    explicit operator bool() const noexcept {
+        return ptr != nullptr;
+    }
+
+    // Number of references owned by this handle
+    long weight() const noexcept {
+        return ref_weight;
+    }
+
+private:
+    T* ptr;
+    long ref_weight;
+};
+
+template<typename T>
+constexpr long weighted_ref<T>::default_weight;
+
+template<typename T>
+void swap(weighted_ref<T>& a, weighted_ref<T>& b) noexcept {
+    a.swap(b);
+}
+
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_WEIGHTED_REF_H_
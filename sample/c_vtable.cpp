@@ -0,0 +1,58 @@
+#include <iostream>
+#include <memory>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/c_vtable.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct object : ref_counted_shared_ptr::std::ref_counted_shared_ptr<object> {
+    ~object() { ++destroyed; }
+};
+
+REF_COUNTED_SHARED_PTR_DEFINE_C_VTABLE(object_vtable, object);
+
+int main() {
+    const ref_counted_shared_ptr_vtable& vtable = object_vtable;
+    long count = -1;
+
+    {
+        auto owner = std::make_shared<object>();
+        const void* handle = static_cast<const object*>(owner.get());
+        SAMPLE_CHECK(vtable.retain(handle, &count) == REF_COUNTED_SHARED_PTR_OK && count == 2);
+        SAMPLE_CHECK(vtable.try_retain(handle, &count) == REF_COUNTED_SHARED_PTR_OK && count == 3);
+        SAMPLE_CHECK(vtable.use_count(handle) == 3);
+        SAMPLE_CHECK(vtable.release(handle, &count) == REF_COUNTED_SHARED_PTR_OK && count == 2);
+        SAMPLE_CHECK(vtable.release(handle, nullptr) == REF_COUNTED_SHARED_PTR_OK);
+        owner.reset();
+        SAMPLE_CHECK(destroyed == 1);
+    }
+
+    {
+        // Never owned by a shared_ptr
+        object unowned;
+        const void* handle = static_cast<const object*>(&unowned);
+        count = -1;
+        SAMPLE_CHECK(vtable.retain(handle, &count) == REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR && count == -1);
+        SAMPLE_CHECK(vtable.release(handle, &count) == REF_COUNTED_SHARED_PTR_BAD_WEAK_PTR && count == -1);
+        SAMPLE_CHECK(vtable.try_retain(handle, &count) == REF_COUNTED_SHARED_PTR_EXPIRED && count == -1);
+        SAMPLE_CHECK(vtable.use_count(handle) == 0);
+    }
+    SAMPLE_CHECK(destroyed == 2);
+
+    {
+        // Still alive after the last release, since its deleter does nothing, so try_retain can be called
+        object kept;
+        const void* handle = static_cast<const object*>(&kept);
+        std::shared_ptr<object> owner(&kept, [](object*) {});
+        SAMPLE_CHECK(vtable.retain(handle, &count) == REF_COUNTED_SHARED_PTR_OK && count == 2);
+        owner.reset();
+        SAMPLE_CHECK(vtable.release(handle, &count) == REF_COUNTED_SHARED_PTR_OK && count == 0);
+        count = -1;
+        SAMPLE_CHECK(vtable.try_retain(handle, &count) == REF_COUNTED_SHARED_PTR_EXPIRED && count == -1);
+        SAMPLE_CHECK(vtable.use_count(handle) == 0);
+    }
+    std::cout << "C vtable: ok\n";
+}
@@ -0,0 +1,15 @@
+#ifndef REF_COUNTED_SHARED_PTR_SAMPLE_CHECK_H_
+#define REF_COUNTED_SHARED_PTR_SAMPLE_CHECK_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+// Like assert, but also checked in release builds, since the samples are run by ctest
+#define SAMPLE_CHECK(...) ((__VA_ARGS__) ? static_cast<void>(0) : ::sample_check_failed(#__VA_ARGS__, __FILE__, __LINE__))
+
+[[noreturn]] inline void sample_check_failed(const char* condition, const char* file, int line) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+    std::abort();
+}
+
+#endif  // REF_COUNTED_SHARED_PTR_SAMPLE_CHECK_H_
@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+
+#include "ref_counted_shared_ptr/std.h"
+
+#include "check.h"
+
+// Releasing the last reference with decref() must free the control block like a shared_ptr would, including the
+// weak reference that the owners hold together (which libc++ keeps in the control block)
+static long allocations = 0;
+
+void* operator new(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    ++allocations;
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    --allocations;
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+static int destroyed = 0;
+
+struct node : ref_counted_shared_ptr::std::ref_counted_shared_ptr<node> {
+    ~node() { ++destroyed; }
+
+    using ref_counted_shared_ptr::incref;
+    using ref_counted_shared_ptr::decref;
+};
+
+int main() {
+    long before = allocations;
+    {
+        // make_shared: one allocation for the object and control block
+        auto s = std::make_shared<node>();
+        node* p = s.get();
+        SAMPLE_CHECK(p->incref() == 2);
+        s.reset();
+        SAMPLE_CHECK(p->decref() == 0 && destroyed == 1);
+    }
+    SAMPLE_CHECK(allocations == before);
+
+    {
+        // A separate control block, freed by the last weak reference
+        std::shared_ptr<node> s(new node);
+        node* p = s.get();
+        std::weak_ptr<node> weak = s;
+        p->incref();
+        s.reset();
+        SAMPLE_CHECK(p->decref() == 0 && destroyed == 2 && weak.expired());
+        SAMPLE_CHECK(allocations > before);
+        weak.reset();
+    }
+    SAMPLE_CHECK(allocations == before);
+
+    std::cout << "control_block_release: ok\n";
+}
@@ -0,0 +1,116 @@
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/coroutine.h"
+
+#include "check.h"
+
+#ifndef REF_COUNTED_SHARED_PTR_HAS_COROUTINES
+#error "ref_counted_shared_ptr/coroutine.h needs C++20 coroutines"
+#endif
+
+// Fire and forget coroutine, which starts running immediately and destroys its own frame when it finishes
+struct task {
+    struct promise_type : ref_counted_shared_ptr::keep_alive_promise {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+};
+
+// Suspended coroutines, resumed by main
+static std::deque<std::coroutine_handle<>> suspended;
+
+struct yield {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { suspended.push_back(handle); }
+    int await_resume() const noexcept { return 1; }
+};
+
+struct ready_value {
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) noexcept {}
+    int await_resume() const noexcept { return 1; }
+};
+
+static std::deque<std::function<void()>> posted;
+
+struct executor {
+    void execute(std::function<void()> f) const { posted.push_back(std::move(f)); }
+};
+
+static int destroyed = 0;
+
+struct connection : ref_counted_shared_ptr::std::ref_counted_shared_ptr<connection> {
+    ~connection() { ++destroyed; }
+
+    int reads = 0;
+
+    using ref_counted_shared_ptr::use_count;
+
+    executor get_executor() const { return {}; }
+
+    task read_ready() {
+        co_await ::ref_counted_shared_ptr::keep_alive(*this);
+        reads += co_await ready_value{};
+    }
+
+    task read() {
+        co_await ::ref_counted_shared_ptr::keep_alive(*this);
+        reads += co_await yield{};
+        reads += co_await yield{};
+    }
+
+    task read_on_executor() {
+        co_await ::ref_counted_shared_ptr::keep_alive_on_executor(*this);
+        reads += co_await yield{};
+    }
+};
+
+static void resume_next() {
+    std::coroutine_handle<> handle = suspended.front();
+    suspended.pop_front();
+    handle.resume();
+}
+
+int main() {
+    {
+        // A coroutine that finishes without suspending never modifies the reference count
+        auto c = std::make_shared<connection>();
+        c->read_ready();
+        SAMPLE_CHECK(c->reads == 1 && c.use_count() == 1);
+    }
+    SAMPLE_CHECK(destroyed == 1);
+
+    {
+        // The object is kept alive across suspensions, by a single incref
+        auto c = std::make_shared<connection>();
+        connection* p = c.get();
+        c->read();
+        SAMPLE_CHECK(c.use_count() == 2);
+        c.reset();
+        resume_next();
+        SAMPLE_CHECK(destroyed == 1 && p->reads == 1 && p->use_count() == 1);
+        resume_next();
+        SAMPLE_CHECK(destroyed == 2 && suspended.empty());
+    }
+
+    {
+        // The final decref is run by the object's executor
+        auto c = std::make_shared<connection>();
+        c->read_on_executor();
+        c.reset();
+        resume_next();
+        SAMPLE_CHECK(destroyed == 2 && posted.size() == 1);
+        posted.front()();
+        posted.pop_front();
+        SAMPLE_CHECK(destroyed == 3);
+    }
+    std::cout << "keep_alive: ok\n";
+}
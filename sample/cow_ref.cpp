@@ -0,0 +1,55 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/cow_ref.h"
+
+#include "check.h"
+
+static int copies = 0;
+
+struct snapshot : ref_counted_shared_ptr::std::ref_counted_shared_ptr<snapshot> {
+    snapshot() = default;
+    snapshot(const snapshot& other) : ref_counted_shared_ptr(other), values(other.values) { ++copies; }
+
+    std::vector<int> values;
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+int main() {
+    auto a = ref_counted_shared_ptr::make_cow<snapshot>();
+    SAMPLE_CHECK(a.unique());
+    a.write().values.push_back(1);  // Unique, so modified in place
+    SAMPLE_CHECK(copies == 0);
+
+    auto b = a;  // Shares the same snapshot
+    SAMPLE_CHECK(b.get() == a.get() && !a.unique() && a->use_count() == 2);
+    b.write().values.push_back(2);  // a is still shared, so b now owns a copy
+    SAMPLE_CHECK(copies == 1 && b.get() != a.get() && a.unique() && b.unique());
+    SAMPLE_CHECK(a->values.size() == 1 && b->values.size() == 2);
+    a.write().values.push_back(3);  // a is unique again, so modified in place
+    SAMPLE_CHECK(copies == 1 && a->values.size() == 2 && a->values[1] == 3);
+
+    {
+        // References from outside of cow_refs count too
+        ref_counted_shared_ptr::ref_counted_ptr<const snapshot> shared = a.share();
+        const snapshot* before = a.get();
+        a.write();
+        SAMPLE_CHECK(copies == 2 && a.get() != before && shared.get() == before && shared->use_count() == 1);
+    }
+
+    {
+        // Taking over a shared_ptr's reference
+        std::shared_ptr<snapshot> p = std::make_shared<snapshot>();
+        std::shared_ptr<snapshot> other = p;
+        ref_counted_shared_ptr::cow_ref<snapshot> c(std::move(p));
+        SAMPLE_CHECK(!p && c.get() == other.get() && c->use_count() == 2 && !c.unique());
+        other.reset();
+        SAMPLE_CHECK(c.unique());
+        c.write();
+        SAMPLE_CHECK(copies == 2);
+    }
+    std::cout << "cow_ref: ok\n";
+}
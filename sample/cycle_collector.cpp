@@ -0,0 +1,73 @@
+#include <iostream>
+#include <memory>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/cycle_collector.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct node : ref_counted_shared_ptr::cycle_collectable<node, ref_counted_shared_ptr::std::ref_counted_shared_ptr<node>> {
+    ~node() { ++destroyed; }
+
+    ::ref_counted_shared_ptr::ref_counted_ptr<node> next;
+    std::shared_ptr<node> other;
+
+    void traverse(::ref_counted_shared_ptr::cycle_visitor& visit) {
+        visit(next);
+        visit(other);
+    }
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+using handle = ref_counted_shared_ptr::ref_counted_ptr<node>;
+
+int main() {
+    {
+        // a <-> b, with c only reachable from a
+        handle a(std::make_shared<node>().get());
+        handle b(std::make_shared<node>().get());
+        a->next = b;
+        b->next = a;
+        a->other = std::make_shared<node>();
+        // Releasing references with a decref while others remain buffers the objects instead
+        b.reset();
+        a.reset();
+        SAMPLE_CHECK(destroyed == 0 && ref_counted_shared_ptr::pending_cycle_roots() == 2);
+        SAMPLE_CHECK(ref_counted_shared_ptr::collect_cycles() == 3);
+        SAMPLE_CHECK(destroyed == 3 && ref_counted_shared_ptr::pending_cycle_roots() == 0);
+    }
+
+    {
+        // A cycle that is still referenced from outside is left alone
+        std::shared_ptr<node> kept = std::make_shared<node>();
+        handle c(kept.get());
+        handle d(std::make_shared<node>().get());
+        c->next = d;
+        d->next = c;
+        d.reset();
+        c.reset();
+        SAMPLE_CHECK(ref_counted_shared_ptr::pending_cycle_roots() == 2);
+        SAMPLE_CHECK(ref_counted_shared_ptr::collect_cycles() == 0);
+        // The collector's references to the roots were released
+        SAMPLE_CHECK(destroyed == 3 && kept->use_count() == 2 && kept->next->use_count() == 1);
+        SAMPLE_CHECK(ref_counted_shared_ptr::pending_cycle_roots() == 0);
+
+        // Releasing the last outside reference with a decref makes it garbage
+        c = handle(kept.get());
+        kept.reset();
+        c.reset();
+        SAMPLE_CHECK(ref_counted_shared_ptr::collect_cycles() == 2 && destroyed == 5);
+    }
+
+    {
+        // Objects released without other references are destroyed without involving the collector
+        handle e(std::make_shared<node>().get());
+        e.reset();
+        SAMPLE_CHECK(destroyed == 6 && ref_counted_shared_ptr::pending_cycle_roots() == 0);
+    }
+    std::cout << "cycle_collectable: ok\n";
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/deferred_decref.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct node : ref_counted_shared_ptr::std::ref_counted_shared_ptr<node> {
+    ~node() {
+        ++destroyed;
+        // Destroyed during a flush, which has to keep going until this decref is done too
+        if (next) ::ref_counted_shared_ptr::decref_deferred(*next);
+        if (flush_next) ::ref_counted_shared_ptr::flush_deferred_decrefs();
+    }
+
+    // Owns one reference, released with decref_deferred
+    node* next = nullptr;
+    // Flushes from the destructor, nesting a flush in the one that destroys this
+    bool flush_next = false;
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+// A reference owned by the caller, to be given back with decref_deferred
+static node* reference_to(const std::shared_ptr<node>& p) {
+    return ref_counted_shared_ptr::ref_counted_ptr<node>(p.get()).release();
+}
+
+static const int chain_length = 5000;
+
+int main() {
+    {
+        auto a = std::make_shared<node>();
+        for (int i = 0; i < 3; ++i) ref_counted_shared_ptr::decref_deferred(*reference_to(a));
+        // Kept alive and combined into one entry until flushed
+        SAMPLE_CHECK(a->use_count() == 4 && ref_counted_shared_ptr::pending_deferred_decrefs() == 1);
+        ref_counted_shared_ptr::flush_deferred_decrefs();
+        SAMPLE_CHECK(a->use_count() == 1 && ref_counted_shared_ptr::pending_deferred_decrefs() == 0);
+    }
+    SAMPLE_CHECK(destroyed == 1);
+
+    {
+        // The last reference of the head of a chain, whose destruction defers the decref of the next node
+        auto tail = std::make_shared<node>();
+        auto head = std::make_shared<node>();
+        head->next = reference_to(tail);
+        ref_counted_shared_ptr::decref_deferred(*reference_to(head));
+        tail.reset();
+        head.reset();
+        SAMPLE_CHECK(destroyed == 1);
+        ref_counted_shared_ptr::flush_deferred_decrefs();
+        SAMPLE_CHECK(destroyed == 3 && ref_counted_shared_ptr::pending_deferred_decrefs() == 0);
+    }
+
+    {
+        // A long chain of nested flushes, which must not run out of stack
+        std::shared_ptr<node> head = std::make_shared<node>();
+        node* last = head.get();
+        for (int i = 1; i != chain_length; ++i) {
+            std::shared_ptr<node> next = std::make_shared<node>();
+            last->next = reference_to(next);
+            last->flush_next = true;
+            last = next.get();
+        }
+        ref_counted_shared_ptr::decref_deferred(*reference_to(head));
+        head.reset();
+        ref_counted_shared_ptr::flush_deferred_decrefs();
+        SAMPLE_CHECK(destroyed == 3 + chain_length && ref_counted_shared_ptr::pending_deferred_decrefs() == 0);
+    }
+
+    {
+        // The buffer flushes itself when it has REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY * 3 / 4 distinct objects
+        const std::size_t max_size = REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY - REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY / 4;
+        std::vector<std::shared_ptr<node>> nodes;
+        for (std::size_t i = 0; i != max_size; ++i) nodes.push_back(std::make_shared<node>());
+        for (std::size_t i = 0; i + 1 != max_size; ++i) ref_counted_shared_ptr::decref_deferred(*reference_to(nodes[i]));
+        SAMPLE_CHECK(ref_counted_shared_ptr::pending_deferred_decrefs() == max_size - 1 && nodes[0]->use_count() == 2);
+        ref_counted_shared_ptr::decref_deferred(*reference_to(nodes.back()));
+        SAMPLE_CHECK(ref_counted_shared_ptr::pending_deferred_decrefs() == 0);
+        for (const std::shared_ptr<node>& p : nodes) SAMPLE_CHECK(p->use_count() == 1);
+    }
+    SAMPLE_CHECK(destroyed == 3 + chain_length + static_cast<int>(REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY - REF_COUNTED_SHARED_PTR_DEFERRED_DECREF_CAPACITY / 4));
+    std::cout << "decref_deferred: ok\n";
+}
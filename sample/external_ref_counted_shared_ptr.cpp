@@ -0,0 +1,78 @@
+#include <iostream>
+#include <memory>
+#include <new>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/mpsc_queue.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct com_object : ref_counted_shared_ptr::std::external_ref_counted_shared_ptr<com_object>, ref_counted_shared_ptr::mpsc_queue_hook {
+    ~com_object() { ++destroyed; }
+
+    using external_ref_counted_shared_ptr::incref;
+    using external_ref_counted_shared_ptr::decref;
+    using external_ref_counted_shared_ptr::use_count;
+    using external_ref_counted_shared_ptr::external_use_count;
+    using external_ref_counted_shared_ptr::is_unique;
+};
+
+// The external count is on a cache line of its own
+static_assert(alignof(com_object) == REF_COUNTED_SHARED_PTR_CACHE_LINE_SIZE, "external count is not aligned");
+
+int main() {
+    {
+        auto s = std::make_shared<com_object>();
+        com_object* p = s.get();
+        SAMPLE_CHECK(p->incref() == 1 && p->incref() == 2);
+        SAMPLE_CHECK(p->external_use_count() == 2 && s.use_count() == 2 && p->use_count() == 3 && !p->is_unique());
+
+        // Releasing more references than there are leaves both counts alone
+        SAMPLE_CHECK(p->decref(3, std::nothrow) == -1);
+        bool threw = false;
+        try {
+            p->decref(3);
+        } catch (const std::bad_weak_ptr&) {
+            threw = true;
+        }
+        SAMPLE_CHECK(threw && p->external_use_count() == 2 && s.use_count() == 2);
+
+        s.reset();
+        SAMPLE_CHECK(p->decref(2) == 0 && destroyed == 1);
+    }
+
+    {
+        // release_to_manual and adopt_manual move the reference into and out of the external count
+        auto s = std::make_shared<com_object>();
+        std::weak_ptr<com_object> weak = s;
+        com_object* p = ref_counted_shared_ptr::std::release_to_manual(std::move(s));
+        SAMPLE_CHECK(!s && p->external_use_count() == 1 && p->use_count() == 1);
+        s = ref_counted_shared_ptr::std::adopt_manual(p);
+        SAMPLE_CHECK(p->external_use_count() == 0 && s.use_count() == 1 && p->is_unique());
+        s.reset();
+        SAMPLE_CHECK(weak.expired() && destroyed == 2);
+    }
+
+    {
+        ref_counted_shared_ptr::mpsc_queue<com_object> queue;
+
+        // A shared_ptr pushed to the queue comes back as a manual reference, counted by the external count
+        queue.push(std::make_shared<com_object>());
+        ref_counted_shared_ptr::ref_counted_ptr<com_object> popped = queue.pop();
+        SAMPLE_CHECK(popped->external_use_count() == 1 && popped->use_count() == 1);
+        popped.reset();
+        SAMPLE_CHECK(destroyed == 3);
+
+        // And the other way around
+        ref_counted_shared_ptr::ref_counted_ptr<com_object> pushed(std::make_shared<com_object>().get());
+        queue.push(std::move(pushed));
+        std::shared_ptr<com_object> shared = queue.pop_shared();
+        SAMPLE_CHECK(shared->external_use_count() == 0 && shared.use_count() == 1);
+        shared.reset();
+        SAMPLE_CHECK(destroyed == 4);
+    }
+    std::cout << "external_ref_counted_shared_ptr: ok\n";
+}
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct node : ref_counted_shared_ptr::std::ref_counted_shared_ptr<node> {
+    ~node() { ++destroyed; }
+
+    using ref_counted_shared_ptr::incref;
+    using ref_counted_shared_ptr::decref;
+    using ref_counted_shared_ptr::try_incref;
+    using ref_counted_shared_ptr::use_count;
+    using ref_counted_shared_ptr::make_immortal;
+    using ref_counted_shared_ptr::is_immortal;
+};
+
+struct constant : ref_counted_shared_ptr::std::immortal_ref_counted_shared_ptr<constant> {
+    using immortal_ref_counted_shared_ptr::incref;
+    using immortal_ref_counted_shared_ptr::decref;
+    using immortal_ref_counted_shared_ptr::use_count;
+    using immortal_ref_counted_shared_ptr::is_immortal;
+};
+
+int main() {
+    const long immortal = ref_counted_shared_ptr::immortal_use_count;
+    {
+        auto p = std::make_shared<node>();
+        SAMPLE_CHECK(!p->is_immortal() && p->incref() == 2 && p->decref() == 1);
+
+        // Every thread makes it immortal at the same time, but the count is only raised once, so a 32 bit
+        // count does not overflow
+        std::atomic<bool> start(false);
+        std::vector<std::thread> threads;
+        for (int i = 0; i != 8; ++i) {
+            threads.emplace_back([&] {
+                while (!start.load()) std::this_thread::yield();
+                p->make_immortal();
+            });
+        }
+        start = true;
+        for (auto& t : threads) t.join();
+        SAMPLE_CHECK(p->is_immortal());
+        long count = p.use_count();
+        SAMPLE_CHECK(count > 1 && count <= INT_MAX);
+        p->make_immortal();
+        SAMPLE_CHECK(p.use_count() == count);
+
+        // incref() and decref() report immortal_use_count and do not change the count
+        SAMPLE_CHECK(p->use_count() == immortal);
+        SAMPLE_CHECK(p->incref() == immortal && p->incref(3) == immortal && p->try_incref() == immortal);
+        SAMPLE_CHECK(p->decref() == immortal && p->decref(5) == immortal);
+        SAMPLE_CHECK(p.use_count() == count);
+
+        // shared_ptr copies still count
+        {
+            std::shared_ptr<node> copy = p;
+            SAMPLE_CHECK(p.use_count() == count + 1 && p->use_count() == immortal);
+        }
+        SAMPLE_CHECK(p.use_count() == count);
+    }
+    // Never destroyed
+    SAMPLE_CHECK(destroyed == 0);
+
+    // Not owned by a shared_ptr
+    static constant c;
+    SAMPLE_CHECK(c.is_immortal() && c.use_count() == immortal);
+    SAMPLE_CHECK(c.incref() == immortal && c.decref() == immortal && c.decref(2) == immortal);
+
+    std::cout << "immortal: ok\n";
+}
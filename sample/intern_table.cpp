@@ -0,0 +1,76 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/intern_table.h"
+
+#include "check.h"
+
+static std::atomic<int> live{0};
+
+struct symbol : ref_counted_shared_ptr::std::ref_counted_shared_ptr<symbol> {
+    explicit symbol(const std::string& name) : name(name) { ++live; }
+    ~symbol() { --live; }
+
+    const std::string& key() const { return name; }
+
+    std::string name;
+};
+
+using table_type = ref_counted_shared_ptr::intern_table<std::string, symbol>;
+
+static table_type* symbols;
+
+// Interns another symbol in its constructor, which intern does not call with a lock held
+struct compound : ref_counted_shared_ptr::std::ref_counted_shared_ptr<compound> {
+    explicit compound(const std::string& name) : name(name), part(symbols->intern(name + ".part")) {}
+
+    const std::string& key() const { return name; }
+
+    std::string name;
+    table_type::handle part;
+};
+
+int main() {
+    table_type table(4);
+    symbols = &table;
+    {
+        table_type::handle a = table.intern("a");
+        table_type::handle b = table.intern("b");
+        SAMPLE_CHECK(table.intern("a") == a && a != b && a->name == "a");
+        SAMPLE_CHECK(table.find("a") == a && !table.find("c"));
+        SAMPLE_CHECK(table.size() == 2 && live == 2);
+
+        // An entry is removed as soon as its object's reference count reaches 0
+        b.reset();
+        SAMPLE_CHECK(table.size() == 1 && live == 1 && !table.find("b"));
+    }
+    SAMPLE_CHECK(table.size() == 0 && live == 0);
+
+    {
+        ref_counted_shared_ptr::intern_table<std::string, compound> compounds(1);
+        ref_counted_shared_ptr::ref_counted_ptr<compound> c = compounds.intern("c");
+        SAMPLE_CHECK(table.find("c.part") == c->part && table.size() == 1);
+    }
+    SAMPLE_CHECK(table.size() == 0 && live == 0);
+
+    {
+        // Threads racing to intern and release the same keys always agree on one object per key at a time
+        std::vector<std::thread> threads;
+        for (int i = 0; i != 4; ++i) {
+            threads.emplace_back([&table, i] {
+                for (int j = 0; j != 20000; ++j) {
+                    std::string key = std::to_string((j * 7 + i) % 50);
+                    table_type::handle a = table.intern(key);
+                    SAMPLE_CHECK(table.intern(key) == a && a->name == key);
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+    }
+    SAMPLE_CHECK(table.size() == 0 && live == 0);
+    std::cout << "intern_table: ok\n";
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/lru_cache.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct page : ref_counted_shared_ptr::std::ref_counted_shared_ptr<page> {
+    explicit page(int number) : number(number) {}
+    ~page() { ++destroyed; }
+
+    int number;
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+using cache_type = ref_counted_shared_ptr::sharded_lru_cache<int, page>;
+
+// The caller's shared_ptr is dropped, so the cache owns the only reference
+static cache_type::handle insert(cache_type& cache, int number) {
+    return cache.insert(number, std::make_shared<page>(number).get());
+}
+
+int main() {
+    {
+        // One shard with room for two entries
+        cache_type cache(2, 1);
+        insert(cache, 1);
+        insert(cache, 2);
+        cache_type::handle kept = cache.find(2);
+        SAMPLE_CHECK(cache.find(1)->number == 1);  // 1 is now the most recently used
+        insert(cache, 3);                          // Evicts 2, the least recently used
+
+        SAMPLE_CHECK(!cache.find(2) && cache.find(1) && cache.find(3));
+        // The evicted page is still alive, since the handle has a reference
+        SAMPLE_CHECK(kept->number == 2 && kept->use_count() == 1 && destroyed == 0);
+        kept.reset();
+        SAMPLE_CHECK(destroyed == 1);
+
+        ref_counted_shared_ptr::lru_cache_statistics statistics = cache.statistics();
+        SAMPLE_CHECK(statistics.entries == 2 && statistics.evictions == 1 && statistics.insertions == 3);
+        SAMPLE_CHECK(statistics.misses == 1);
+
+        SAMPLE_CHECK(cache.erase(1) && !cache.erase(1) && destroyed == 2);
+    }
+    SAMPLE_CHECK(destroyed == 3);
+
+    {
+        cache_type cache(2, 1, ref_counted_shared_ptr::eviction_policy::pinned_aware);
+        cache_type::handle pinned = insert(cache, 1);
+        insert(cache, 2);
+        insert(cache, 3);  // 1 is the least recently used, but is in use, so 2 is evicted instead
+        SAMPLE_CHECK(cache.find(1) && !cache.find(2) && cache.find(3));
+
+        pinned.reset();
+        insert(cache, 4);  // Now 1 can be evicted
+        SAMPLE_CHECK(!cache.find(1) && cache.find(3) && cache.find(4));
+        SAMPLE_CHECK(cache.statistics().entries == 2);
+    }
+    SAMPLE_CHECK(destroyed == 7);
+    std::cout << "sharded_lru_cache: ok\n";
+}
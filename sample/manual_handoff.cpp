@@ -0,0 +1,75 @@
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "ref_counted_shared_ptr/std.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+// No accessors: adopt_manual uses the aliasing constructor
+struct plain : ref_counted_shared_ptr::std::ref_counted_shared_ptr<plain> {
+    ~plain() { ++destroyed; }
+
+    using ref_counted_shared_ptr::incref;
+    using ref_counted_shared_ptr::decref;
+    using ref_counted_shared_ptr::use_count;
+};
+
+// Both accessor macros for the same type: adopt_manual writes the shared_ptr directly
+struct typed : ref_counted_shared_ptr::std::typed_ref_counted_shared_ptr<typed> {
+    ~typed() { ++destroyed; }
+
+    using typed_ref_counted_shared_ptr::incref;
+    using typed_ref_counted_shared_ptr::decref;
+    using typed_ref_counted_shared_ptr::use_count;
+};
+
+REF_COUNTED_SHARED_PTR_DEFINE_PRIVATE_ACCESSORS_STD(typed);
+REF_COUNTED_SHARED_PTR_DEFINE_SHARED_PTR_ACCESSORS_STD(typed);
+
+// The handoff through manual references is the same for both
+template<typename T>
+static void round_trip() {
+    auto s = std::make_shared<T>();
+    std::shared_ptr<T> other = s;
+    SAMPLE_CHECK(s->use_count() == 2);
+
+    // The shared_ptr's reference becomes a manual reference
+    T* p = ref_counted_shared_ptr::std::release_to_manual(std::move(s));
+    SAMPLE_CHECK(!s && p == other.get() && p->use_count() == 2);
+
+    // And back
+    s = ref_counted_shared_ptr::std::adopt_manual(p);
+    SAMPLE_CHECK(s.get() == p && p->use_count() == 2);
+
+    // A shared_ptr made with the aliasing constructor from another owner does not own a reference to the object,
+    // so release_to_manual takes a new one instead
+    std::shared_ptr<int> owner = std::make_shared<int>();
+    std::shared_ptr<T> aliased(owner, p);
+    SAMPLE_CHECK(p->use_count() == 2 && owner.use_count() == 2);
+    SAMPLE_CHECK(ref_counted_shared_ptr::std::release_to_manual(std::move(aliased)) == p && !aliased);
+    SAMPLE_CHECK(p->use_count() == 3 && owner.use_count() == 1);
+    SAMPLE_CHECK(p->decref() == 2);
+
+    // Manual references hold the object up after every shared_ptr is gone
+    p->incref();
+    s.reset();
+    other.reset();
+    SAMPLE_CHECK(p->use_count() == 1);
+    int before = destroyed;
+    ref_counted_shared_ptr::std::adopt_manual(p).reset();
+    SAMPLE_CHECK(destroyed == before + 1);
+
+    // Null pointers go through unchanged
+    SAMPLE_CHECK(ref_counted_shared_ptr::std::release_to_manual(std::shared_ptr<T>()) == nullptr);
+    SAMPLE_CHECK(!ref_counted_shared_ptr::std::adopt_manual(static_cast<T*>(nullptr)));
+}
+
+int main() {
+    round_trip<plain>();
+    round_trip<typed>();
+    SAMPLE_CHECK(destroyed == 2);
+    std::cout << "manual_handoff: ok\n";
+}
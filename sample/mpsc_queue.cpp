@@ -0,0 +1,78 @@
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/mpsc_queue.h"
+
+#include "check.h"
+
+static std::atomic<int> destroyed{0};
+
+struct message : ref_counted_shared_ptr::std::ref_counted_shared_ptr<message>, ref_counted_shared_ptr::mpsc_queue_hook {
+    message(int producer, int sequence) : producer(producer), sequence(sequence) {}
+    ~message() { ++destroyed; }
+
+    int producer;
+    int sequence;
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+int main() {
+    {
+        ref_counted_shared_ptr::mpsc_queue<message> queue;
+        SAMPLE_CHECK(queue.empty() && !queue.pop());
+
+        // Round trip through a shared_ptr, without modifying the reference count
+        auto p = std::make_shared<message>(0, 0);
+        message* pushed = p.get();
+        queue.push(std::move(p));
+        SAMPLE_CHECK(!queue.empty());
+        std::shared_ptr<message> popped = queue.pop_shared();
+        SAMPLE_CHECK(popped.get() == pushed && popped.use_count() == 1 && popped->use_count() == 1);
+        SAMPLE_CHECK(queue.empty() && !queue.pop_shared());
+
+        // Mixed with ref_counted_ptrs, in the order they were pushed
+        queue.push(std::move(popped));
+        queue.push(ref_counted_shared_ptr::ref_counted_ptr<message>(std::make_shared<message>(0, 1).get()));
+        SAMPLE_CHECK(queue.pop()->sequence == 0);
+        SAMPLE_CHECK(queue.pop_shared()->sequence == 1);
+        SAMPLE_CHECK(destroyed == 2);
+
+        // The destructor releases what is left
+        queue.push(std::make_shared<message>(0, 2));
+    }
+    SAMPLE_CHECK(destroyed == 3);
+
+    {
+        // Each producer's messages arrive in the order it pushed them
+        const int producer_count = 4;
+        const int per_producer = 10000;
+        ref_counted_shared_ptr::mpsc_queue<message> queue;
+        std::vector<std::thread> producers;
+        for (int i = 0; i != producer_count; ++i) {
+            producers.emplace_back([&queue, i] {
+                for (int j = 0; j != per_producer; ++j) queue.push(std::make_shared<message>(i, j));
+            });
+        }
+
+        std::vector<int> next(producer_count, 0);
+        int received = 0;
+        while (received != producer_count * per_producer) {
+            ref_counted_shared_ptr::ref_counted_ptr<message> m = queue.pop();
+            if (!m) {
+                std::this_thread::yield();
+                continue;
+            }
+            SAMPLE_CHECK(m->use_count() == 1 && m->sequence == next[m->producer]++);
+            ++received;
+        }
+        for (std::thread& t : producers) t.join();
+        SAMPLE_CHECK(queue.empty());
+    }
+    SAMPLE_CHECK(destroyed == 3 + 4 * 10000);
+    std::cout << "mpsc_queue: ok\n";
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/recycling.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+
+#include "check.h"
+
+static int constructed = 0;
+static int destroyed = 0;
+static int recycled = 0;
+
+struct message : ref_counted_shared_ptr::std::ref_counted_shared_ptr<message> {
+    message() { ++constructed; }
+    ~message() { ++destroyed; }
+
+    int payload = 0;
+
+    using ref_counted_shared_ptr::use_count;
+
+private:
+    friend struct ::ref_counted_shared_ptr::detail::access;
+
+    void recycle() noexcept {
+        payload = 0;
+        ++recycled;
+    }
+};
+
+int main() {
+    message* first;
+    {
+        std::shared_ptr<message> a = ref_counted_shared_ptr::make_recycled<message>();
+        first = a.get();
+        a->payload = 5;
+    }
+    SAMPLE_CHECK(constructed == 1 && destroyed == 0 && recycled == 1);
+
+    {
+        // The same object is reused, reset by recycle()
+        std::shared_ptr<message> b = ref_counted_shared_ptr::make_recycled<message>();
+        SAMPLE_CHECK(b.get() == first && b->payload == 0 && b.use_count() == 1 && b->use_count() == 1);
+        std::weak_ptr<message> weak = b;
+
+        // The last reference can also be released by a decref
+        ref_counted_shared_ptr::ref_counted_ptr<message> r(b.get());
+        b.reset();
+        SAMPLE_CHECK(!weak.expired());
+        r.reset();
+        SAMPLE_CHECK(weak.expired() && recycled == 2);
+
+        // Why recycled objects must not be observed through weak_ptr: a stale weak_ptr locks the next use of the object
+        std::shared_ptr<message> c = ref_counted_shared_ptr::make_recycled<message>();
+        SAMPLE_CHECK(c.get() == first && weak.lock() == c);
+    }
+    SAMPLE_CHECK(constructed == 1 && destroyed == 0 && recycled == 3);
+
+    {
+        // Objects that do not fit in the freelist are deleted
+        std::vector<std::shared_ptr<message>> messages;
+        for (int i = 0; i != REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY + 10; ++i) messages.push_back(ref_counted_shared_ptr::make_recycled<message>());
+        SAMPLE_CHECK(constructed == REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY + 10);
+    }
+    SAMPLE_CHECK(destroyed == 10);
+
+    // Other threads have their own freelists, deleted when the thread exits
+    std::thread([] {
+        std::shared_ptr<message> m = ref_counted_shared_ptr::make_recycled<message>();
+    }).join();
+    SAMPLE_CHECK(constructed == REF_COUNTED_SHARED_PTR_RECYCLE_CAPACITY + 11 && destroyed == 11);
+    std::cout << "make_recycled: ok\n";
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/ref_counted_ptr.h"
+#include "ref_counted_shared_ptr/ref_counted_vector.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+// incref and decref stay protected: ref_counted_ptr and ref_counted_vector use them through detail::access
+struct node : ref_counted_shared_ptr::std::ref_counted_shared_ptr<node> {
+    explicit node(int value) : value(value) {}
+    ~node() { ++destroyed; }
+
+    int value;
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+int main() {
+    auto a = std::make_shared<node>(1);
+    auto b = std::make_shared<node>(2);
+
+    {
+        ref_counted_shared_ptr::ref_counted_ptr<node> p(a.get());
+        SAMPLE_CHECK(a->use_count() == 2);
+        ref_counted_shared_ptr::ref_counted_ptr<node> q = p;
+        SAMPLE_CHECK(a->use_count() == 3 && q == p);
+        SAMPLE_CHECK(p.shared() == a);
+        node* released = q.release();
+        SAMPLE_CHECK(!q && a->use_count() == 3);
+        ref_counted_shared_ptr::ref_counted_ptr<node> adopted(released, ref_counted_shared_ptr::adopt_ref);
+    }
+    SAMPLE_CHECK(a->use_count() == 1);
+
+    {
+        ref_counted_shared_ptr::ref_counted_vector<node> v{a.get(), b.get(), nullptr};
+        SAMPLE_CHECK(v.size() == 3 && a->use_count() == 2 && b->use_count() == 2);
+
+        // Growing copies pointers without touching reference counts
+        v.reserve(100);
+        SAMPLE_CHECK(a->use_count() == 2);
+
+        ref_counted_shared_ptr::ref_counted_vector<node> copy = v;
+        SAMPLE_CHECK(a->use_count() == 3 && copy[1] == b.get() && copy[2] == nullptr);
+
+        {
+            ref_counted_shared_ptr::ref_counted_ptr<node> first = v.ref(0);
+            SAMPLE_CHECK(first.get() == a.get() && a->use_count() == 4);
+        }
+        SAMPLE_CHECK(a->use_count() == 3);
+        SAMPLE_CHECK(v.shared(1) == b);
+
+        v.push_back(std::make_shared<node>(3).get());
+        // The shared_ptr was destroyed, so the vector's reference is the only one
+        SAMPLE_CHECK(v.back()->value == 3 && v.back()->use_count() == 1);
+        ref_counted_shared_ptr::ref_counted_ptr<node> taken = v.take_back();
+        SAMPLE_CHECK(taken->value == 3 && taken->use_count() == 1 && destroyed == 0);
+        taken.reset();
+        SAMPLE_CHECK(destroyed == 1);
+
+        copy.erase(copy.begin(), copy.end());
+        SAMPLE_CHECK(copy.empty() && a->use_count() == 2 && b->use_count() == 2);
+    }
+    SAMPLE_CHECK(a->use_count() == 1 && b->use_count() == 1);
+
+    a.reset();
+    b.reset();
+    SAMPLE_CHECK(destroyed == 3);
+    std::cout << "ref_counted_ptr and ref_counted_vector: ok\n";
+}
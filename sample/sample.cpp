@@ -19,10 +19,16 @@ struct test : ref_counted_shared_ptr::NS::ref_counted_shared_ptr<test> {
 // Only if inheriting from typed_ref_counted_shared_ptr
 // REF_COUNTED_SHARED_PTR_DEFINE_PRIVATE_ACCESSORS(test);
 
-int main() {
+// Built with REF_COUNTED_SHARED_PTR_TRACE defined as ref_counted_shared_ptr_sample_traced, which writes its trace
+// to the path given as its first argument (read it with ref_counted_shared_ptr_trace_history)
+int main(int argc, char** argv) {
 #define STR(X) #X
 #define TO_STR(X) STR(X)
 
+#ifdef REF_COUNTED_SHARED_PTR_TRACE
+    ref_counted_shared_ptr::trace::enable();
+#endif
+
 #ifdef REF_COUNTED_SHARED_PTR_STD
     std::cout << "Using " TO_STR(REF_COUNTED_SHARED_PTR_STD) " <memory> implementation\n";
 #endif
@@ -39,4 +45,14 @@ int main() {
     std::cout << "ptr->use_count(): " << ptr->use_count() << "\nx = ptr->decref()\n";
     long x = ptr->decref();
     std::cout << "x: " << x << '\n';
+
+#ifdef REF_COUNTED_SHARED_PTR_TRACE
+    if (argc > 1 && !ref_counted_shared_ptr::trace::dump(argv[1])) {
+        std::cerr << "Could not write the trace to " << argv[1] << '\n';
+        return 1;
+    }
+#else
+    static_cast<void>(argc);
+    static_cast<void>(argv);
+#endif
 }
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "ref_counted_shared_ptr/std.h"
+#include "ref_counted_shared_ptr/weighted_ref.h"
+
+#include "check.h"
+
+static int destroyed = 0;
+
+struct job : ref_counted_shared_ptr::std::ref_counted_shared_ptr<job> {
+    ~job() { ++destroyed; }
+
+    using ref_counted_shared_ptr::use_count;
+};
+
+using handle = ref_counted_shared_ptr::weighted_ref<job>;
+
+int main() {
+    const long weight = handle::default_weight;
+    {
+        auto p = std::make_shared<job>();
+        handle root(p.get());
+        SAMPLE_CHECK(root.weight() == weight && p->use_count() == 1 + weight);
+
+        // Splitting and merging only move weight between handles
+        handle half = root.split();
+        handle quarter = half.split();
+        SAMPLE_CHECK(root.weight() == weight / 2 && half.weight() == weight / 4 && quarter.weight() == weight / 4);
+        SAMPLE_CHECK(p->use_count() == 1 + weight);
+        SAMPLE_CHECK(half.merge(std::move(quarter)));
+        SAMPLE_CHECK(!quarter && half.weight() == weight / 2 && p->use_count() == 1 + weight);
+
+        // Handed to another thread, which drops it
+        std::thread([](handle h) { SAMPLE_CHECK(h->use_count() > 1); }, std::move(half)).join();
+        SAMPLE_CHECK(p->use_count() == 1 + weight / 2);
+
+        {
+            // ref() takes 1 of the weight
+            ref_counted_shared_ptr::ref_counted_ptr<job> r = root.ref();
+            SAMPLE_CHECK(root.weight() == weight / 2 - 1 && p->use_count() == 1 + weight / 2);
+        }
+        SAMPLE_CHECK(p->use_count() == weight / 2);
+
+        // release() gives back all but 1 of the weight
+        ref_counted_shared_ptr::ref_counted_ptr<job> released = root.release();
+        SAMPLE_CHECK(!root && p->use_count() == 2);
+
+        // A handle with a weight of 1 increfs the default weight before splitting
+        handle single(std::move(released));
+        SAMPLE_CHECK(single.weight() == 1);
+        handle more = single.split();
+        SAMPLE_CHECK(single.weight() + more.weight() == 1 + weight && p->use_count() == 2 + weight);
+    }
+    SAMPLE_CHECK(destroyed == 1);
+
+    {
+        // The object is destroyed when the last handle is, whichever it is
+        auto p = std::make_shared<job>();
+        handle a(p.get());
+        handle b = a.split();
+        p.reset();
+        a.reset();
+        SAMPLE_CHECK(destroyed == 1);
+        b.reset();
+        SAMPLE_CHECK(destroyed == 2);
+    }
+
+    {
+        // Handles to different objects are not merged
+        auto p = std::make_shared<job>();
+        auto q = std::make_shared<job>();
+        handle a(p.get());
+        handle b(q.get());
+        SAMPLE_CHECK(!a.merge(std::move(b)));
+        SAMPLE_CHECK(a.get() == p.get() && a.weight() == weight && p->use_count() == 1 + weight);
+        SAMPLE_CHECK(b.get() == q.get() && b.weight() == weight && q->use_count() == 1 + weight);
+
+        // Merging into a null handle takes the other handle
+        handle empty;
+        SAMPLE_CHECK(empty.merge(std::move(b)) && !b && empty.get() == q.get() && empty.weight() == weight);
+    }
+    SAMPLE_CHECK(destroyed == 4);
+    std::cout << "weighted_ref: ok\n";
+}
@@ -0,0 +1,118 @@
+// Reconstructs per-object reference count histories from a dump written by ref_counted_shared_ptr::trace::dump.
+// Usage: trace_history <dump file> [object address]
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#include <cxxabi.h>
+#endif
+
+#include "ref_counted_shared_ptr/trace.h"
+
+namespace trace = ref_counted_shared_ptr::trace;
+
+static bool read_exact(std::FILE* file, void* data, std::size_t size) {
+    return std::fread(data, 1, size, file) == size;
+}
+
+static std::string demangle(const std::string& name) {
+#if defined(__GNUC__) || defined(__clang__)
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status == 0 && demangled) {
+        std::string result = demangled;
+        std::free(demangled);
+        return result;
+    }
+#endif
+    return name.empty() ? "<unknown type>" : name;
+}
+
+static const char* operation_name(std::uint16_t operation) {
+    switch (static_cast<trace::operation_type>(operation)) {
+        case trace::operation_type::incref: return "incref";
+        case trace::operation_type::decref: return "decref";
+        case trace::operation_type::zero_references: return "zero_references";
+        case trace::operation_type::bad_weak_ptr: return "bad_weak_ptr";
+        case trace::operation_type::try_incref_failed: return "try_incref_failed";
+    }
+    return "<unknown operation>";
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        std::fprintf(stderr, "usage: %s <dump file> [object address]\n", argv[0]);
+        return 2;
+    }
+
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    char magic[sizeof(trace::dump_magic)];
+    std::uint32_t header[3];
+    if (!read_exact(file, magic, sizeof(magic)) || std::memcmp(magic, trace::dump_magic, sizeof(magic)) != 0 || !read_exact(file, header, sizeof(header))) {
+        std::fprintf(stderr, "%s: not a ref_counted_shared_ptr trace dump\n", argv[1]);
+        return 1;
+    }
+    if (header[0] != trace::dump_version || header[1] != sizeof(trace::record)) {
+        std::fprintf(stderr, "%s: unsupported dump version %" PRIu32 " (record size %" PRIu32 ")\n", argv[1], header[0], header[1]);
+        return 1;
+    }
+
+    std::map<std::uint32_t, std::string> type_names;
+    for (std::uint32_t i = 0; i < header[2]; ++i) {
+        std::uint32_t entry[2];
+        if (!read_exact(file, entry, sizeof(entry))) return std::fprintf(stderr, "%s: truncated type table\n", argv[1]), 1;
+        std::string name(entry[1], '\0');
+        if (entry[1] && !read_exact(file, &name[0], entry[1])) return std::fprintf(stderr, "%s: truncated type table\n", argv[1]), 1;
+        type_names[entry[0]] = demangle(name);
+    }
+
+    std::uint64_t record_count;
+    if (!read_exact(file, &record_count, sizeof(record_count))) return std::fprintf(stderr, "%s: truncated dump\n", argv[1]), 1;
+
+    std::uint64_t only_object = argc == 3 ? std::strtoull(argv[2], nullptr, 0) : 0;
+    std::map<std::uint64_t, std::vector<trace::record>> histories;
+    std::uint64_t first_timestamp = UINT64_MAX;
+    for (std::uint64_t i = 0; i < record_count; ++i) {
+        trace::record r;
+        if (!read_exact(file, &r, sizeof(r))) return std::fprintf(stderr, "%s: truncated dump\n", argv[1]), 1;
+        if (r.object == 0 || (only_object && r.object != only_object)) continue;
+        histories[r.object].push_back(r);
+        first_timestamp = std::min(first_timestamp, r.timestamp);
+    }
+    std::fclose(file);
+
+    for (auto& history : histories) {
+        std::vector<trace::record>& records = history.second;
+        std::stable_sort(records.begin(), records.end(), [](const trace::record& a, const trace::record& b) {
+            return a.timestamp < b.timestamp;
+        });
+
+        // The same address may be reused by a new object after the old one was destroyed. A record of another type,
+        // or an incref after zero_references, starts the history of the new object.
+        const trace::record* previous = nullptr;
+        bool reached_zero = false;
+        for (const trace::record& r : records) {
+            bool is_incref = r.operation == static_cast<std::uint16_t>(trace::operation_type::incref);
+            if (!previous || r.type_id != previous->type_id || (reached_zero && is_incref)) {
+                std::printf("object 0x%" PRIx64 " (%s)\n", history.first, type_names[r.type_id].c_str());
+                reached_zero = false;
+            }
+            const char* note = reached_zero ? "  <- after zero_references" : "";
+            if (r.operation == static_cast<std::uint16_t>(trace::operation_type::zero_references)) reached_zero = true;
+            std::printf("  +%12" PRIu64 " ns  thread %-5" PRIu16 " %-17s -> %" PRId64 "%s\n", r.timestamp - first_timestamp, r.thread_id, operation_name(r.operation), r.count, note);
+            previous = &r;
+        }
+    }
+}